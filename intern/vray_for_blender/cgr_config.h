@@ -218,7 +218,9 @@ struct ScopedTraceFormat: public ScopedTrace {
 	char buffer[1024];
 };
 
+#ifndef SCOPED_TRACE
 #define SCOPED_TRACE(name) ScopedTrace _scopedTrace ## __COUNTER__ (name);
+#endif
 #define SCOPED_TRACE_EX(...) ScopedTraceFormat _scopedTraceFormat ## __COUNTER__ (__VA_ARGS__);
 #else
 struct ScopedTrace {
@@ -228,7 +230,10 @@ struct ScopedTraceFormat: public ScopedTrace {
 	ScopedTraceFormat(...) {}
 };
 #define PRINT_TRACE(...)
+// gtest defines its own SCOPED_TRACE
+#ifndef SCOPED_TRACE
 #define SCOPED_TRACE(_)
+#endif
 #define SCOPED_TRACE_EX(...)
 #endif
 
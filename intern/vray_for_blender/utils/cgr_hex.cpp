@@ -0,0 +1,149 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#include "cgr_hex.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// Digit value to char for base 41: 'A'-'Z', '0'-'9', 'a'-'e'
+static const char base41Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcde";
+
+
+void HexEncodeScalar(const uint8_t *buf, size_t nBytes, char *str)
+{
+    for (size_t i = 0; i < nBytes; ++i) {
+        str[i*2+0] = hexDigits[buf[i] >> 4];
+        str[i*2+1] = hexDigits[buf[i] & 0xF];
+    }
+}
+
+
+void Base41EncodeScalar(const uint8_t *buf, size_t nBytes, char *str)
+{
+    for (size_t i = 0; i < nBytes/2; ++i) {
+        uint16_t w;
+        memcpy(&w, buf+i*2, sizeof(w));
+        str[i*3+0] = base41Digits[w%41];
+        w /= 41;
+        str[i*3+1] = base41Digits[w%41];
+        str[i*3+2] = base41Digits[w/41];
+    }
+}
+
+
+#ifdef __SSE2__
+
+// Convert 16 nibbles (0-15) to hex digits
+static inline __m128i nibbleToHex(__m128i n)
+{
+    const __m128i over9 = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+                        _mm_and_si128(over9, _mm_set1_epi8('A' - '0' - 10)));
+}
+
+
+void HexEncode(const uint8_t *buf, size_t nBytes, char *str)
+{
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 16 <= nBytes; i += 16) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)(buf + i));
+        const __m128i hi = nibbleToHex(_mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask));
+        const __m128i lo = nibbleToHex(_mm_and_si128(bytes, lowMask));
+
+        _mm_storeu_si128((__m128i*)(str + i*2),      _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(str + i*2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+
+    HexEncodeScalar(buf + i, nBytes - i, str + i*2);
+}
+
+
+// Convert 8 base 41 digits (0-40) in 16 bit lanes to chars
+static inline __m128i digitToBase41(__m128i d)
+{
+    const __m128i over25 = _mm_cmpgt_epi16(d, _mm_set1_epi16(25));
+    const __m128i over35 = _mm_cmpgt_epi16(d, _mm_set1_epi16(35));
+
+    __m128i c = _mm_add_epi16(d, _mm_set1_epi16('A'));
+    c = _mm_add_epi16(c, _mm_and_si128(over25, _mm_set1_epi16('0' - 26 - 'A')));
+    c = _mm_add_epi16(c, _mm_and_si128(over35, _mm_set1_epi16(('a' - 36) - ('0' - 26))));
+    return c;
+}
+
+
+void Base41Encode(const uint8_t *buf, size_t nBytes, char *str)
+{
+    const size_t nWords = nBytes / 2;
+
+    // Each word is stored with one 4 byte write where the last byte is overwritten by the next word,
+    // so keep the last block for the scalar loop to not write past the output
+    size_t i = 0;
+    for (; i + 8 < nWords; i += 8) {
+        const __m128i w = _mm_loadu_si128((const __m128i*)(buf + i*2));
+
+        // Exact divisions by multiplying with magic numbers:
+        // w / 1681 == (w * 19961) >> 25 for any 16 bit w, and r / 41 == (r * 1599) >> 16 for r < 1681
+        const __m128i d2 = _mm_srli_epi16(_mm_mulhi_epu16(w, _mm_set1_epi16(19961)), 9);
+        const __m128i r  = _mm_sub_epi16(w, _mm_mullo_epi16(d2, _mm_set1_epi16(1681)));
+        const __m128i d1 = _mm_mulhi_epu16(r, _mm_set1_epi16(1599));
+        const __m128i d0 = _mm_sub_epi16(r, _mm_mullo_epi16(d1, _mm_set1_epi16(41)));
+
+        const __m128i c0 = digitToBase41(d0);
+        const __m128i c1 = _mm_slli_epi16(digitToBase41(d1), 8);
+        const __m128i c2 = digitToBase41(d2);
+
+        // Pack the 3 chars of each word in 32 bit lanes: c0 | c1 << 8 | c2 << 16
+        const __m128i c01 = _mm_or_si128(c0, c1);
+        uint32_t packed[8];
+        _mm_storeu_si128((__m128i*)packed,     _mm_unpacklo_epi16(c01, c2));
+        _mm_storeu_si128((__m128i*)packed + 1, _mm_unpackhi_epi16(c01, c2));
+
+        char *out = str + i*3;
+        for (int c = 0; c < 8; ++c) {
+            memcpy(out + c*3, &packed[c], sizeof(uint32_t));
+        }
+    }
+
+    Base41EncodeScalar(buf + i*2, nBytes - i*2, str + i*3);
+}
+
+#else // __SSE2__
+
+void HexEncode(const uint8_t *buf, size_t nBytes, char *str)
+{
+    HexEncodeScalar(buf, nBytes, str);
+}
+
+
+void Base41Encode(const uint8_t *buf, size_t nBytes, char *str)
+{
+    Base41EncodeScalar(buf, nBytes, str);
+}
+
+#endif // __SSE2__
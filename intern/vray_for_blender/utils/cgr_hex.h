@@ -0,0 +1,40 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef CGR_HEX_H
+#define CGR_HEX_H
+
+#include <stdint.h>
+
+#include <stddef.h>
+
+// Text encodings used for binary data in .vrscene files.
+// Output is not null terminated.
+
+// Upper case hex, 2 chars per byte
+void  HexEncode(const uint8_t *buf, size_t nBytes, char *str);
+// Base 41 used for zipped data, 3 chars per 16 bit word; nBytes must be even
+void  Base41Encode(const uint8_t *buf, size_t nBytes, char *str);
+
+// Plain table driven versions, used as fallback for the vectorized ones and as reference in tests
+void  HexEncodeScalar(const uint8_t *buf, size_t nBytes, char *str);
+void  Base41EncodeScalar(const uint8_t *buf, size_t nBytes, char *str);
+
+#endif // CGR_HEX_H
@@ -0,0 +1,177 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#include "cgr_voxel.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+
+
+static inline size_t voxelIndex(const int res[3], int x, int y, int z)
+{
+    return (size_t(z) * res[1] + y) * res[0] + x;
+}
+
+
+// True if any of @count values is above @threshold
+static inline bool anyAbove(const float *values, int count, float threshold)
+{
+    for (int i = 0; i < count; ++i) {
+        if (fabsf(values[i]) > threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+VoxelRegion FindActiveVoxelBricks(const float *const *grids, int count, const int res[3],
+                                  int brickSize, float threshold, std::vector<char> &active)
+{
+    const int bricks[3] = {
+        (res[0] + brickSize - 1) / brickSize,
+        (res[1] + brickSize - 1) / brickSize,
+        (res[2] + brickSize - 1) / brickSize,
+    };
+    active.assign(size_t(bricks[0]) * bricks[1] * bricks[2], 0);
+
+    int minBrick[3] = {bricks[0], bricks[1], bricks[2]};
+    int maxBrick[3] = {-1, -1, -1};
+
+    // scan whole rows so memory is read in order, a brick is skipped once it is known to be active
+    for (int z = 0; z < res[2]; ++z) {
+        const int bz = z / brickSize;
+        for (int y = 0; y < res[1]; ++y) {
+            const int by = y / brickSize;
+            char *brickRow = &active[(size_t(bz) * bricks[1] + by) * bricks[0]];
+
+            for (int bx = 0; bx < bricks[0]; ++bx) {
+                if (brickRow[bx]) {
+                    continue;
+                }
+
+                const int x = bx * brickSize;
+                const int width = std::min(brickSize, res[0] - x);
+                const size_t start = voxelIndex(res, x, y, z);
+
+                for (int g = 0; g < count; ++g) {
+                    if (grids[g] && anyAbove(grids[g] + start, width, threshold)) {
+                        brickRow[bx] = 1;
+                        minBrick[0] = std::min(minBrick[0], bx);
+                        maxBrick[0] = std::max(maxBrick[0], bx);
+                        minBrick[1] = std::min(minBrick[1], by);
+                        maxBrick[1] = std::max(maxBrick[1], by);
+                        minBrick[2] = std::min(minBrick[2], bz);
+                        maxBrick[2] = std::max(maxBrick[2], bz);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    VoxelRegion region;
+    if (maxBrick[0] < 0) {
+        for (int c = 0; c < 3; ++c) {
+            region.offset[c] = 0;
+            region.size[c] = 1;
+        }
+        return region;
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        const int begin = std::max(0, minBrick[c] * brickSize - 1);
+        const int end = std::min(res[c], (maxBrick[c] + 1) * brickSize + 1);
+        region.offset[c] = begin;
+        region.size[c] = end - begin;
+    }
+    return region;
+}
+
+
+void CopyVoxelBricks(float *dest, const float *source, const int res[3], const VoxelRegion &region,
+                     int brickSize, const std::vector<char> &active, bool quantizeHalf)
+{
+    const int bricksX = (res[0] + brickSize - 1) / brickSize;
+    const int bricksY = (res[1] + brickSize - 1) / brickSize;
+    const int xBegin = region.offset[0];
+    const int xEnd = region.offset[0] + region.size[0];
+
+    for (int z = region.offset[2]; z < region.offset[2] + region.size[2]; ++z) {
+        for (int y = region.offset[1]; y < region.offset[1] + region.size[1]; ++y) {
+            const char *brickRow = &active[(size_t(z / brickSize) * bricksY + y / brickSize) * bricksX];
+            const float *from = source + voxelIndex(res, 0, y, z);
+
+            // copy runs of voxels from the same brick
+            for (int x = xBegin; x < xEnd;) {
+                const int runEnd = std::min(xEnd, (x / brickSize + 1) * brickSize);
+                const int run = runEnd - x;
+
+                if (!brickRow[x / brickSize]) {
+                    memset(dest, 0, run * sizeof(float));
+                } else if (quantizeHalf) {
+                    for (int i = 0; i < run; ++i) {
+                        dest[i] = QuantizeHalf(from[x + i]);
+                    }
+                } else {
+                    memcpy(dest, from + x, run * sizeof(float));
+                }
+
+                dest += run;
+                x = runEnd;
+            }
+        }
+    }
+}
+
+
+float QuantizeHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = bits & 0x80000000u;
+    const uint32_t exponent = (bits >> 23) & 0xFF;
+
+    if (exponent == 0xFF) {
+        // keep inf and NaN
+        return value;
+    }
+    if (exponent < 127 - 14) {
+        // below the smallest normal half
+        bits = sign;
+    }
+    else {
+        // round the 23 bit mantissa to 10 bits, ties to even
+        bits += 0x00000FFFu + ((bits >> 13) & 1);
+        bits &= 0xFFFFE000u;
+
+        // the largest half is 65504
+        if (((bits >> 23) & 0xFF) > 127 + 15) {
+            bits = sign | 0x477FE000u;
+        }
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
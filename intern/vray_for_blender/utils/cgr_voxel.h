@@ -0,0 +1,51 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef CGR_VOXEL_H
+#define CGR_VOXEL_H
+
+#include <vector>
+
+// Voxel grids are stored with x varying fastest, then y, then z, as Blender's smoke grids.
+
+// Box of voxels of a grid
+struct VoxelRegion {
+    int offset[3];
+    int size[3];
+};
+
+// Find the bricks of @brickSize^3 voxels having a value above @threshold in any of the @count grids.
+//   grids  - @count grids of @res voxels, null grids are skipped
+//   active - output, one flag per brick, bricks are ordered as voxels
+// Returns the box of the active bricks grown by one voxel on each side so it is bordered by zeros after
+// CopyVoxelBricks, clamped to the grid; a single voxel box at the origin if no brick is active
+VoxelRegion FindActiveVoxelBricks(const float *const *grids, int count, const int res[3],
+                                  int brickSize, float threshold, std::vector<char> &active);
+
+// Copy the voxels of @region from @source to @dest, which has the size of @region.
+// Voxels of inactive bricks are written as 0; with @quantizeHalf values are rounded to half precision.
+void CopyVoxelBricks(float *dest, const float *source, const int res[3], const VoxelRegion &region,
+                     int brickSize, const std::vector<char> &active, bool quantizeHalf);
+
+// Round @value to the nearest value representable as a half float.
+// Values beyond the half range are clamped to it, values below the smallest normal half are flushed to 0.
+float QuantizeHalf(float value);
+
+#endif // CGR_VOXEL_H
@@ -26,8 +26,10 @@
 #include "MEM_guardedalloc.h"
 
 #include "cgr_vrscene.h"
+#include "cgr_hex.h"
 
 #include <zlib.h>
+#include <algorithm>
 
 
 struct TraceTransform {
@@ -36,44 +38,16 @@ struct TraceTransform {
 };
 
 
-inline char letr2char(int d)
-{
-    if (d>=0 && d<26) return 'A'+d;
-    d-=26;
-    if (d>=0 && d<=9) return '0'+d;
-    d-=10;
-    if (d>=0 && d<26) return 'a'+d;
-    return '?';
-}
-
-
-inline void word2str(u_int16_t w, char *str)
-{
-    int d0=w%41;
-    w/=41;
-    int d1=w%41;
-    w/=41;
-    int d2=w%41;
-    *str=letr2char(d0);
-    str++;
-    *str=letr2char(d1);
-    str++;
-    *str=letr2char(d2);
-}
-
-
 static int hex2str(const u_int8_t *bytes, unsigned numBytes, char *str, unsigned strMaxLen)
 {
     if (strMaxLen<numBytes*2/3+1)
         return -1;
 
-    for (unsigned i=0; i<numBytes/2; i++) {
-        word2str(*((u_int16_t*) (bytes+i*2)), str);
-        str+=3;
-    }
+    Base41Encode(bytes, numBytes & ~1u, str);
+    str+=numBytes/2*3;
     if (numBytes&1) {
         u_int8_t b[2]={ bytes[numBytes-1], 0 };
-        word2str(*((u_int16_t*) b), str);
+        Base41Encode(b, 2, str);
         str+=3;
     }
     *str=0;
@@ -103,12 +77,7 @@ static void int2hex(u_int32_t i, char *hex)
 
 void getStringHex(const u_int8_t *buf, unsigned nBytes, char *pstr)
 {
-    for(unsigned i = 0; i < nBytes; ++i) {
-        char val0 = int2hexValue((buf[i]>>4)&0xF);
-        char val1 = int2hexValue(buf[i]&0xF);
-        pstr[i*2+0] = val0;
-        pstr[i*2+1] = val1;
-    }
+    HexEncode(buf, nBytes, pstr);
     pstr[nBytes*2] = 0;
 }
 
@@ -181,6 +150,97 @@ char* GetFloatArrayZip(float *data, size_t size)
 }
 
 
+void AppendStringHex(const u_int8_t *buf, size_t bufLen, std::string &out)
+{
+    const size_t offset = out.size();
+    out.resize(offset + bufLen*2);
+    HexEncode(buf, bufLen, &out[offset]);
+}
+
+
+bool AppendStringZip(const u_int8_t *buf, size_t bufLen, std::string &out, int level)
+{
+    // Max input passed to zlib at once, avail_in is only 32 bit
+    const size_t inBlockSize  = 1 << 24;
+    // Compressed data is encoded and appended after each block of this size
+    const size_t outBlockSize = 1 << 16;
+
+    // Header keeps both sizes as 32 bit hex numbers
+    if (bufLen > 0xFFFFFFFFu) {
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, level) != Z_OK) {
+        return false;
+    }
+
+    const size_t headerOffset = out.size();
+    out.append("ZIPB");
+    out.append(16, '0');
+
+    // First byte is reserved for odd byte left from the previous block since we encode in pairs of bytes
+    u_int8_t  temp[outBlockSize + 1];
+    size_t    tempUsed = 0;
+    size_t    inOffset = 0;
+    int       err = Z_OK;
+
+    while (err == Z_OK) {
+        if (stream.avail_in == 0 && inOffset < bufLen) {
+            const size_t inSize = std::min(inBlockSize, bufLen - inOffset);
+            stream.next_in  = (Bytef*)(buf + inOffset);
+            stream.avail_in = inSize;
+            inOffset += inSize;
+        }
+
+        stream.next_out  = (Bytef*)(temp + tempUsed);
+        stream.avail_out = outBlockSize;
+
+        err = deflate(&stream, inOffset < bufLen ? Z_NO_FLUSH : Z_FINISH);
+        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+            break;
+        }
+        if (err == Z_BUF_ERROR) {
+            // no progress possible only happens when there was nothing to do
+            err = Z_OK;
+        }
+
+        tempUsed += outBlockSize - stream.avail_out;
+
+        const size_t encodeBytes = tempUsed & ~size_t(1);
+        const size_t strOffset = out.size();
+        out.resize(strOffset + encodeBytes/2*3);
+        Base41Encode(temp, encodeBytes, &out[strOffset]);
+
+        if (tempUsed & 1) {
+            temp[0] = temp[tempUsed - 1];
+        }
+        tempUsed &= 1;
+    }
+
+    const uLong zipLen = stream.total_out;
+    deflateEnd(&stream);
+
+    if (err != Z_STREAM_END || zipLen > 0xFFFFFFFFu) {
+        out.resize(headerOffset);
+        return false;
+    }
+
+    if (tempUsed) {
+        u_int8_t b[2]={ temp[0], 0 };
+        const size_t strOffset = out.size();
+        out.resize(strOffset + 3);
+        Base41Encode(b, 2, &out[strOffset]);
+    }
+
+    int2hex(bufLen, &out[headerOffset + 4]);
+    int2hex(zipLen, &out[headerOffset + 4 + 8]);
+
+    return true;
+}
+
+
 void GetDoubleHex(float f, char *buf)
 {
     double d = double(f);
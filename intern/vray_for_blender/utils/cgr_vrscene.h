@@ -48,6 +48,12 @@ char* GetHex(const u_int8_t *buf, unsigned bufLen);
 char* GetStringZip(const u_int8_t *buf, unsigned bufLen);
 char* GetFloatArrayZip(float *data, size_t size);
 
+// Same encodings as GetHex / GetStringZip, but appended to the end of the string.
+// Zip data is compressed in bounded blocks, so only the encoded result is ever held in memory.
+// Returns false and leaves the string unchanged on failure.
+void  AppendStringHex(const u_int8_t *buf, size_t bufLen, std::string &out);
+bool  AppendStringZip(const u_int8_t *buf, size_t bufLen, std::string &out, int level=1);
+
 int   GetPythonAttrInt(PyObject *propGroup, const char *attrName, int def=0);
 float GetPythonAttrFloat(PyObject *propGroup, const char *attrName, float def=0.0f);
 
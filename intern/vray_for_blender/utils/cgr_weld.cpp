@@ -0,0 +1,99 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#include "cgr_weld.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+
+// Bits of the float with -0 mapped to +0, so equal floats have equal keys
+static inline uint32_t floatKey(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits == 0x80000000u ? 0u : bits;
+}
+
+
+static inline uint32_t vectorHash(uint32_t x, uint32_t y, uint32_t z)
+{
+    // murmur3 style mixing, enough to spread UVs that differ only in low mantissa bits
+    uint32_t h = x * 0xcc9e2d51u;
+    h ^= (y * 0x1b873593u) + 0x9e3779b9u + (h << 6) + (h >> 2);
+    h ^= (z * 0xcc9e2d51u) + 0x9e3779b9u + (h << 6) + (h >> 2);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+
+int WeldVectors(const float (*values)[3], int count, int *indices, int *uniqueSources)
+{
+    if (count <= 0) {
+        return 0;
+    }
+
+    // Open addressing table of unique vector indices, at most half full
+    size_t tableSize = 16;
+    while (tableSize < size_t(count) * 2) {
+        tableSize <<= 1;
+    }
+    const size_t mask = tableSize - 1;
+    std::vector<int> table(tableSize, -1);
+
+    // Keys of the unique vectors, compared instead of going back to the values
+    std::vector<uint32_t> uniqueKeys;
+    uniqueKeys.reserve(size_t(count) * 3);
+
+    int uniqueCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const uint32_t x = floatKey(values[i][0]);
+        const uint32_t y = floatKey(values[i][1]);
+        const uint32_t z = floatKey(values[i][2]);
+
+        size_t slot = vectorHash(x, y, z) & mask;
+        while (true) {
+            const int unique = table[slot];
+            if (unique < 0) {
+                table[slot] = uniqueCount;
+                uniqueSources[uniqueCount] = i;
+                uniqueKeys.push_back(x);
+                uniqueKeys.push_back(y);
+                uniqueKeys.push_back(z);
+                indices[i] = uniqueCount++;
+                break;
+            }
+
+            const uint32_t *key = &uniqueKeys[size_t(unique) * 3];
+            if (key[0] == x && key[1] == y && key[2] == z) {
+                indices[i] = unique;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return uniqueCount;
+}
@@ -0,0 +1,35 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef CGR_WELD_H
+#define CGR_WELD_H
+
+#include <stddef.h>
+
+// Merge equal 3 float vectors, as used for UV and vertex color channel vertices.
+// Vectors are equal if all components compare equal with ==, NaNs are equal if their bits are.
+//   values        - @count vectors
+//   indices       - output, for each input vector the index of its unique vector
+//   uniqueSources - output, for each unique vector the index of its first occurrence in @values,
+//                   unique vectors are numbered in order of first occurrence; needs room for @count items
+// Returns the number of unique vectors
+int  WeldVectors(const float (*values)[3], int count, int *indices, int *uniqueSources);
+
+#endif // CGR_WELD_H
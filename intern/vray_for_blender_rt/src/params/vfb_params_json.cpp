@@ -18,12 +18,22 @@
 
 #include "vfb_typedefs.h"
 #include "vfb_params_json.h"
+#include "vfb_log.h"
+#include "utils/cgr_hash.h"
+
+#include "BLI_fileops.h"
+extern "C" {
+#include "BKE_appdir.h"
+}
 
 #ifdef _MSC_VER
 #include <boost/config/compiler/visualc.hpp>
 #endif
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <map>
 
 #define SKIP_TYPE(attrType) (\
@@ -81,178 +91,449 @@ static MapPluginType PluginTypeToDescription;
 static MapPluginDesc PluginDescriptions;
 
 
-void VRayForBlender::InitPluginDescriptions(const std::string &dirPath)
+namespace {
+
+/// Bump when the layout of the cache or the parsing of the json files changes
+const uint32_t PluginDescCacheVersion = 1;
+const char     PluginDescCacheMagic[8] = {'V', 'F', 'B', 'P', 'D', 'E', 'S', 'C'};
+const char     PluginDescCacheName[] = "vfb_plugin_desc.cache";
+
+/// Identifies the set of json files a cache was made from
+struct CacheFingerprint {
+	uint64_t hash[2];
+
+	bool operator==(const CacheFingerprint &other) const {
+		return hash[0] == other.hash[0] && hash[1] == other.hash[1];
+	}
+};
+
+/// Buffer for the cache file, each distinct string is stored once in a table and referenced by index
+struct CacheWriter {
+	std::string                      data; ///< Everything after the string table
+	std::vector<const std::string*>  strings; ///< Distinct strings in order of first use
+	HashMap<std::string, uint32_t>   stringIndex; ///< String -> index in strings
+
+	template <typename T>
+	void put(const T &value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void putString(const std::string &str) {
+		auto iter = stringIndex.find(str);
+		if (iter == stringIndex.end()) {
+			iter = stringIndex.emplace(str, static_cast<uint32_t>(strings.size())).first;
+			strings.push_back(&iter->first);
+		}
+		put<uint32_t>(iter->second);
+	}
+};
+
+/// Reads values from the cache file data, all reads past the end fail and clear good
+struct CacheReader {
+	const char                *pos;
+	const char                *end;
+	std::vector<std::string>   strings;
+	bool                       good;
+
+	CacheReader(const char *data, size_t size)
+	    : pos(data)
+	    , end(data + size)
+	    , good(true)
+	{}
+
+	template <typename T>
+	T get() {
+		T value = T();
+		if (end - pos < static_cast<ptrdiff_t>(sizeof(T))) {
+			good = false;
+			pos = end;
+		} else {
+			memcpy(&value, pos, sizeof(T));
+			pos += sizeof(T);
+		}
+		return value;
+	}
+
+	const std::string & getString() {
+		static const std::string empty;
+		const uint32_t index = get<uint32_t>();
+		if (index >= strings.size()) {
+			good = false;
+			return empty;
+		}
+		return strings[index];
+	}
+};
+
+} // namespace
+
+
+/// Hash the path, size and modification time of the description files
+static CacheFingerprint GetCacheFingerprint(const std::string &dirPath, const std::vector<boost::filesystem::path> &files)
 {
-	boost::filesystem::recursive_directory_iterator pIt(dirPath);
-	boost::filesystem::recursive_directory_iterator end;
+	std::string data = dirPath;
+	for (const boost::filesystem::path &path : files) {
+		boost::system::error_code ec;
+		const uint64_t size = boost::filesystem::file_size(path, ec);
+		const int64_t mtime = boost::filesystem::last_write_time(path, ec);
 
-	for (; pIt != end; ++pIt) {
-		const boost::filesystem::path &path = *pIt;
-		if (path.extension() == ".json") {
-			// NOTE: Filename is plugin ID
-#ifdef _WIN32
-			const std::string &fileName = path.stem().string();
-#else
-			const std::string &fileName = path.stem().c_str();
-#endif
-			std::ifstream fileStream(path.c_str());
+		data.push_back('\0');
+		data += path.string();
+		data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+		data.append(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+	}
 
-			boost::property_tree::ptree pTree;
-			boost::property_tree::json_parser::read_json(fileStream, pTree);
+	CacheFingerprint fingerprint;
+	MurmurHash3_x64_128(data.data(), static_cast<int>(data.size()), PluginDescCacheVersion, fingerprint.hash);
+	return fingerprint;
+}
 
-			PluginParamDesc &pluginDesc = PluginDescriptions[fileName];
-			pluginDesc.pluginID   = fileName;
-			pluginDesc.pluginType = ParamDesc::GetPluginTypeFromString(pTree.get_child("Type").data());
 
-			PluginTypeToDescription[pluginDesc.pluginType].push_back(&pluginDesc);
+/// Write @descs to @cachePath, the file is replaced only when completely written
+static void WriteCache(const std::string &cachePath, const CacheFingerprint &fingerprint, const std::vector<PluginParamDesc> &descs)
+{
+	CacheWriter writer;
+	writer.put<uint32_t>(static_cast<uint32_t>(descs.size()));
+	for (const PluginParamDesc &desc : descs) {
+		writer.putString(desc.pluginID);
+		writer.put<int32_t>(desc.pluginType);
+		writer.put<uint32_t>(static_cast<uint32_t>(desc.attributes.size()));
+		for (const auto &attrIt : desc.attributes) {
+			const AttrDesc &attrDesc = attrIt.second;
+			writer.putString(attrDesc.name);
+			writer.put<int32_t>(attrDesc.type);
+			writer.put<int32_t>(attrDesc.options.optionData);
+			writer.putString(attrDesc.descRamp.colors);
+			writer.putString(attrDesc.descRamp.positions);
+			writer.putString(attrDesc.descRamp.interpolations);
+			writer.putString(attrDesc.descCurve.positions);
+			writer.putString(attrDesc.descCurve.values);
+			writer.putString(attrDesc.descCurve.interpolations);
+		}
+	}
 
-			for (auto &v : pTree.get_child("Parameters")) {
-				const std::string &attrName = v.second.get_child("attr").data();
-				const std::string &attrType = v.second.get_child("type").data();
+	CacheWriter header;
+	header.data.append(PluginDescCacheMagic, sizeof(PluginDescCacheMagic));
+	header.put<uint32_t>(PluginDescCacheVersion);
+	header.put(fingerprint.hash);
+	header.put<uint32_t>(static_cast<uint32_t>(writer.strings.size()));
+	for (const std::string *str : writer.strings) {
+		header.put<uint32_t>(static_cast<uint32_t>(str->size()));
+		header.data += *str;
+	}
 
-				// NOTE: "skip" means fake attribute and / or that attribute must be handled
-				// manually
-				if (v.second.count("skip")) {
-					if (v.second.get<bool>("skip")) {
-						continue;
-					}
-				}
+	// unique per writer, so processes starting at the same time do not write to the same file
+	const std::string tmpPath = cachePath + "." + boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%").string() + ".tmp";
+	FILE *file = BLI_fopen(tmpPath.c_str(), "wb");
+	if (!file) {
+		getLog().warning("Failed to create plugin description cache \"%s\"", tmpPath.c_str());
+		return;
+	}
+	const bool written = fwrite(header.data.data(), 1, header.data.size(), file) == header.data.size() &&
+	                     fwrite(writer.data.data(), 1, writer.data.size(), file) == writer.data.size();
+	fclose(file);
 
-				AttrDesc &attrDesc = pluginDesc.attributes[attrName];
-				attrDesc.name = attrName;
-				attrDesc.options = AttrOptionNone;
-				if (v.second.count("options")) {
-					const auto options = v.second.get_child("options");
-					for (auto & opt : options) {
-						if (opt.second.data() == "EXPORT_AS_ACOLOR") {
-							attrDesc.options |= AttrOptionExportAsColor;
-						}
-					}
-				}
-				attrDesc.type = AttrTypeInvalid;
+	boost::system::error_code ec;
+	if (written) {
+		boost::filesystem::rename(tmpPath, cachePath, ec);
+	}
+	if (!written || ec) {
+		getLog().warning("Failed to write plugin description cache \"%s\"", cachePath.c_str());
+		boost::filesystem::remove(tmpPath, ec);
+	}
+}
 
-				if (attrType == "BOOL") {
-					attrDesc.type = AttrTypeBool;
-				}
-				else if (attrType == "INT") {
-					attrDesc.type = AttrTypeInt;
-				}
-				else if (attrType == "FLOAT") {
-					attrDesc.type = AttrTypeFloat;
-				}
-				else if (attrType == "ENUM") {
-					attrDesc.type = AttrTypeEnum;
-				}
-				else if (attrType == "COLOR") {
-					attrDesc.type = AttrTypeColor;
-				}
-				else if (attrType == "ACOLOR") {
-					attrDesc.type = AttrTypeAColor;
-				}
-				else if (attrType == "MATRIX") {
-					attrDesc.type = AttrTypeMatrix;
-				}
-				else if (attrType == "MATRIX_TEXTURE") {
-					// this is texture that samples matricies but can also accept a single matrix
-					attrDesc.type = AttrTypeMatrix;
-				}
-				else if (attrType == "TRANSFORM") {
-					attrDesc.type = AttrTypeTransform;
-				}
-				else if (attrType == "TRANSFORM_TEXTURE") {
-					// this is texture that samples transforms but can also accept a single transfrom
-					attrDesc.type = AttrTypeTransform;
-				}
-				else if (attrType == "VECTOR") {
-					attrDesc.type = AttrTypeVector;
-				}
-				else if (attrType == "TEXTURE") {
-					attrDesc.type = AttrTypePluginTexture;
-				}
-				else if (attrType == "FLOAT_TEXTURE") {
-					attrDesc.type = AttrTypePluginTextureFloat;
-				}
-				else if (attrType == "INT_TEXTURE") {
-					attrDesc.type = AttrTypePluginTextureInt;
-				}
-				else if (attrType == "STRING") {
-					attrDesc.type = AttrTypeString;
-				}
-				else if (attrType == "PLUGIN") {
-					attrDesc.type = AttrTypePlugin;
-				}
-				else if (attrType == "GEOMETRY") {
-					attrDesc.type = AttrTypePluginGeometry;
-				}
-				else if (attrType == "BRDF") {
-					attrDesc.type = AttrTypePluginBRDF;
-				}
-				else if (attrType == "UVWGEN") {
-					attrDesc.type = AttrTypePluginUvwgen;
-				}
-				else if (attrType == "MATERIAL") {
-					attrDesc.type = AttrTypePluginMaterial;
-				}
-				else if (attrType == "OUTPUT_PLUGIN") {
-					attrDesc.type = AttrTypeOutputPlugin;
-				}
-				else if (attrType == "OUTPUT_COLOR") {
-					attrDesc.type = AttrTypeOutputColor;
-				}
-				else if (attrType == "OUTPUT_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTexture;
-				}
-				else if (attrType == "OUTPUT_FLOAT_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTextureFloat;
-				}
-				else if (attrType == "OUTPUT_INT_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTextureInt;
-				}
-				else if (attrType == "OUTPUT_VECTOR_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTextureVector;
-				}
-				else if (attrType == "OUTPUT_MATRIX_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTextureMatrix;
-				}
-				else if (attrType == "OUTPUT_TRANSFORM_TEXTURE") {
-					attrDesc.type = AttrTypeOutputTextureTransform;
-				}
-				else if (attrType == "LIST") {
-					attrDesc.type = AttrTypeList;
-				}
-				else if (attrType == "PLUGIN_LIST") {
-					attrDesc.type = AttrTypeListPlugin;
-				}
-				else if (attrType == "WIDGET_RAMP") {
-					attrDesc.type = AttrTypeWidgetRamp;
-
-					const auto &rampDesc = v.second.get_child("attrs");
-					if (rampDesc.count("colors")) {
-						attrDesc.descRamp.colors = rampDesc.get_child("colors").data();
-					}
-					if (rampDesc.count("positions")) {
-						attrDesc.descRamp.positions = rampDesc.get_child("positions").data();
-					}
-					if (rampDesc.count("interpolations")) {
-						attrDesc.descRamp.interpolations = rampDesc.get_child("interpolations").data();
-					}
-				}
-				else if (attrType == "WIDGET_CURVE") {
-					attrDesc.type = AttrTypeWidgetCurve;
-
-					const auto &curveDesc = v.second.get_child("attrs");
-					if (curveDesc.count("values")) {
-						attrDesc.descCurve.values = curveDesc.get_child("values").data();
-					}
-					if (curveDesc.count("positions")) {
-						attrDesc.descCurve.positions = curveDesc.get_child("positions").data();
-					}
-					if (curveDesc.count("interpolations")) {
-						attrDesc.descCurve.interpolations = curveDesc.get_child("interpolations").data();
-					}
+
+/// Load the descriptions from @cachePath with a single read if it was made from the same json files
+/// @return - true if @descs was filled from the cache
+static bool ReadCache(const std::string &cachePath, const CacheFingerprint &fingerprint, std::vector<PluginParamDesc> &descs)
+{
+	std::vector<char> buffer;
+	FILE *file = BLI_fopen(cachePath.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+	if (fseek(file, 0, SEEK_END) == 0) {
+		const long size = ftell(file);
+		if (size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+			buffer.resize(size);
+			if (fread(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+				buffer.clear();
+			}
+		}
+	}
+	fclose(file);
+
+	if (buffer.size() < sizeof(PluginDescCacheMagic) || memcmp(buffer.data(), PluginDescCacheMagic, sizeof(PluginDescCacheMagic))) {
+		return false;
+	}
+
+	CacheReader reader(buffer.data() + sizeof(PluginDescCacheMagic), buffer.size() - sizeof(PluginDescCacheMagic));
+	const uint32_t version = reader.get<uint32_t>();
+	CacheFingerprint cacheFingerprint;
+	cacheFingerprint.hash[0] = reader.get<uint64_t>();
+	cacheFingerprint.hash[1] = reader.get<uint64_t>();
+	if (!reader.good || version != PluginDescCacheVersion || !(cacheFingerprint == fingerprint)) {
+		getLog().debug("Plugin description cache \"%s\" is outdated", cachePath.c_str());
+		return false;
+	}
+
+	const uint32_t stringCount = reader.get<uint32_t>();
+	for (uint32_t c = 0; c < stringCount && reader.good; ++c) {
+		const uint32_t length = reader.get<uint32_t>();
+		if (reader.end - reader.pos < length) {
+			reader.good = false;
+			break;
+		}
+		reader.strings.emplace_back(reader.pos, length);
+		reader.pos += length;
+	}
+
+	const uint32_t pluginCount = reader.get<uint32_t>();
+	for (uint32_t c = 0; c < pluginCount && reader.good; ++c) {
+		descs.emplace_back();
+		PluginParamDesc &desc = descs.back();
+		desc.pluginID   = reader.getString();
+		desc.pluginType = static_cast<PluginType>(reader.get<int32_t>());
+
+		const uint32_t attrCount = reader.get<uint32_t>();
+		desc.attributes.reserve(attrCount);
+		for (uint32_t i = 0; i < attrCount && reader.good; ++i) {
+			const std::string &name = reader.getString();
+			AttrDesc &attrDesc = desc.attributes[name];
+			attrDesc.name                     = name;
+			attrDesc.type                     = static_cast<AttrType>(reader.get<int32_t>());
+			attrDesc.options                  = static_cast<AttrOptions>(reader.get<int32_t>());
+			attrDesc.descRamp.colors          = reader.getString();
+			attrDesc.descRamp.positions       = reader.getString();
+			attrDesc.descRamp.interpolations  = reader.getString();
+			attrDesc.descCurve.positions      = reader.getString();
+			attrDesc.descCurve.values         = reader.getString();
+			attrDesc.descCurve.interpolations = reader.getString();
+		}
+	}
+
+	if (!reader.good || reader.pos != reader.end) {
+		getLog().warning("Plugin description cache \"%s\" is corrupted", cachePath.c_str());
+		descs.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
+/// Parse the json description of @pluginDesc.pluginID from @path
+static void ParsePluginDescription(const boost::filesystem::path &path, PluginParamDesc &pluginDesc)
+{
+	std::ifstream fileStream(path.c_str());
+
+	boost::property_tree::ptree pTree;
+	boost::property_tree::json_parser::read_json(fileStream, pTree);
+
+	pluginDesc.pluginType = ParamDesc::GetPluginTypeFromString(pTree.get_child("Type").data());
+
+	for (auto &v : pTree.get_child("Parameters")) {
+		const std::string &attrName = v.second.get_child("attr").data();
+		const std::string &attrType = v.second.get_child("type").data();
+
+		// NOTE: "skip" means fake attribute and / or that attribute must be handled
+		// manually
+		if (v.second.count("skip")) {
+			if (v.second.get<bool>("skip")) {
+				continue;
+			}
+		}
+
+		AttrDesc &attrDesc = pluginDesc.attributes[attrName];
+		attrDesc.name = attrName;
+		attrDesc.options = AttrOptionNone;
+		if (v.second.count("options")) {
+			const auto options = v.second.get_child("options");
+			for (auto & opt : options) {
+				if (opt.second.data() == "EXPORT_AS_ACOLOR") {
+					attrDesc.options |= AttrOptionExportAsColor;
 				}
 			}
 		}
+		attrDesc.type = AttrTypeInvalid;
+
+		if (attrType == "BOOL") {
+			attrDesc.type = AttrTypeBool;
+		}
+		else if (attrType == "INT") {
+			attrDesc.type = AttrTypeInt;
+		}
+		else if (attrType == "FLOAT") {
+			attrDesc.type = AttrTypeFloat;
+		}
+		else if (attrType == "ENUM") {
+			attrDesc.type = AttrTypeEnum;
+		}
+		else if (attrType == "COLOR") {
+			attrDesc.type = AttrTypeColor;
+		}
+		else if (attrType == "ACOLOR") {
+			attrDesc.type = AttrTypeAColor;
+		}
+		else if (attrType == "MATRIX") {
+			attrDesc.type = AttrTypeMatrix;
+		}
+		else if (attrType == "MATRIX_TEXTURE") {
+			// this is texture that samples matricies but can also accept a single matrix
+			attrDesc.type = AttrTypeMatrix;
+		}
+		else if (attrType == "TRANSFORM") {
+			attrDesc.type = AttrTypeTransform;
+		}
+		else if (attrType == "TRANSFORM_TEXTURE") {
+			// this is texture that samples transforms but can also accept a single transfrom
+			attrDesc.type = AttrTypeTransform;
+		}
+		else if (attrType == "VECTOR") {
+			attrDesc.type = AttrTypeVector;
+		}
+		else if (attrType == "TEXTURE") {
+			attrDesc.type = AttrTypePluginTexture;
+		}
+		else if (attrType == "FLOAT_TEXTURE") {
+			attrDesc.type = AttrTypePluginTextureFloat;
+		}
+		else if (attrType == "INT_TEXTURE") {
+			attrDesc.type = AttrTypePluginTextureInt;
+		}
+		else if (attrType == "STRING") {
+			attrDesc.type = AttrTypeString;
+		}
+		else if (attrType == "PLUGIN") {
+			attrDesc.type = AttrTypePlugin;
+		}
+		else if (attrType == "GEOMETRY") {
+			attrDesc.type = AttrTypePluginGeometry;
+		}
+		else if (attrType == "BRDF") {
+			attrDesc.type = AttrTypePluginBRDF;
+		}
+		else if (attrType == "UVWGEN") {
+			attrDesc.type = AttrTypePluginUvwgen;
+		}
+		else if (attrType == "MATERIAL") {
+			attrDesc.type = AttrTypePluginMaterial;
+		}
+		else if (attrType == "OUTPUT_PLUGIN") {
+			attrDesc.type = AttrTypeOutputPlugin;
+		}
+		else if (attrType == "OUTPUT_COLOR") {
+			attrDesc.type = AttrTypeOutputColor;
+		}
+		else if (attrType == "OUTPUT_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTexture;
+		}
+		else if (attrType == "OUTPUT_FLOAT_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTextureFloat;
+		}
+		else if (attrType == "OUTPUT_INT_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTextureInt;
+		}
+		else if (attrType == "OUTPUT_VECTOR_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTextureVector;
+		}
+		else if (attrType == "OUTPUT_MATRIX_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTextureMatrix;
+		}
+		else if (attrType == "OUTPUT_TRANSFORM_TEXTURE") {
+			attrDesc.type = AttrTypeOutputTextureTransform;
+		}
+		else if (attrType == "LIST") {
+			attrDesc.type = AttrTypeList;
+		}
+		else if (attrType == "PLUGIN_LIST") {
+			attrDesc.type = AttrTypeListPlugin;
+		}
+		else if (attrType == "WIDGET_RAMP") {
+			attrDesc.type = AttrTypeWidgetRamp;
+
+			const auto &rampDesc = v.second.get_child("attrs");
+			if (rampDesc.count("colors")) {
+				attrDesc.descRamp.colors = rampDesc.get_child("colors").data();
+			}
+			if (rampDesc.count("positions")) {
+				attrDesc.descRamp.positions = rampDesc.get_child("positions").data();
+			}
+			if (rampDesc.count("interpolations")) {
+				attrDesc.descRamp.interpolations = rampDesc.get_child("interpolations").data();
+			}
+		}
+		else if (attrType == "WIDGET_CURVE") {
+			attrDesc.type = AttrTypeWidgetCurve;
+
+			const auto &curveDesc = v.second.get_child("attrs");
+			if (curveDesc.count("values")) {
+				attrDesc.descCurve.values = curveDesc.get_child("values").data();
+			}
+			if (curveDesc.count("positions")) {
+				attrDesc.descCurve.positions = curveDesc.get_child("positions").data();
+			}
+			if (curveDesc.count("interpolations")) {
+				attrDesc.descCurve.interpolations = curveDesc.get_child("interpolations").data();
+			}
+		}
+	}
+}
+
+
+/// Get the path of the description cache file, empty if there is no user config directory
+static std::string GetCachePath()
+{
+	const char *configDir = BKE_appdir_folder_id_create(BLENDER_USER_CONFIG, nullptr);
+	if (!configDir) {
+		return "";
+	}
+	return (boost::filesystem::path(configDir) / PluginDescCacheName).string();
+}
+
+
+void VRayForBlender::InitPluginDescriptions(const std::string &dirPath)
+{
+	std::vector<boost::filesystem::path> files;
+	boost::filesystem::recursive_directory_iterator pIt(dirPath);
+	boost::filesystem::recursive_directory_iterator end;
+	for (; pIt != end; ++pIt) {
+		const boost::filesystem::path &path = *pIt;
+		if (path.extension() == ".json") {
+			files.push_back(path);
+		}
+	}
+	// directory order differs between file systems, keep the fingerprint and load order stable
+	std::sort(files.begin(), files.end());
+
+	const CacheFingerprint fingerprint = GetCacheFingerprint(dirPath, files);
+	const std::string cachePath = GetCachePath();
+
+	std::vector<PluginParamDesc> descs;
+	if (!cachePath.empty() && ReadCache(cachePath, fingerprint, descs)) {
+		getLog().info("Loaded %d plugin descriptions from cache \"%s\"", static_cast<int>(descs.size()), cachePath.c_str());
+	}
+	else {
+		descs.resize(files.size());
+		for (int c = 0; c < files.size(); ++c) {
+			// NOTE: Filename is plugin ID
+#ifdef _WIN32
+			descs[c].pluginID = files[c].stem().string();
+#else
+			descs[c].pluginID = files[c].stem().c_str();
+#endif
+			ParsePluginDescription(files[c], descs[c]);
+		}
+		if (!cachePath.empty()) {
+			WriteCache(cachePath, fingerprint, descs);
+		}
+	}
+
+	for (PluginParamDesc &desc : descs) {
+		PluginParamDesc &pluginDesc = PluginDescriptions[desc.pluginID];
+		pluginDesc = std::move(desc);
+		PluginTypeToDescription[pluginDesc.pluginType].push_back(&pluginDesc);
 	}
 }
 
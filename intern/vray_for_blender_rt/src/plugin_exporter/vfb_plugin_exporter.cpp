@@ -44,11 +44,12 @@ PluginExporter::~PluginExporter() {}
 
 
 int PluginExporter::remove_plugin(const std::string &name) {
-	std::lock_guard<std::recursive_mutex> lock(m_exportMtx);
+	std::lock_guard<std::recursive_mutex> nameLock(getNameLock(name));
 	int result = 1;
 	if (m_pluginManager.inCache(name)) {
 		getLog().info("Removing plugin: [%s]", name.c_str());
 		m_pluginManager.remove(name);
+		std::lock_guard<std::recursive_mutex> lock(m_exportMtx);
 		result = this->remove_plugin_impl(name);
 	}
 	return result;
@@ -66,25 +67,60 @@ AttrPlugin PluginExporter::export_plugin(const PluginDesc &pluginDesc, bool repl
 		return AttrPlugin(pluginDesc.pluginName);
 	}
 
-	std::lock_guard<std::recursive_mutex> lock(m_exportMtx);
+	const bool profile = m_profiler.isEnabled();
+	const auto profileStart = profile ? ExportProfiler::Clock::now() : ExportProfiler::Clock::time_point();
+	double waitSeconds = 0.0;
+
+	// hash the plugin once for all checks below, before locking so plugins can be hashed in parallel
+	PluginManager::PluginDescHash descHash = m_pluginManager.makeHash(pluginDesc);
+
+	// the cache entry of the plugin is only changed while its name lock is held,
+	// so the checks and diffs below run in parallel with exports of other plugins
+	const auto lockStart = profile ? ExportProfiler::Clock::now() : ExportProfiler::Clock::time_point();
+	std::lock_guard<std::recursive_mutex> nameLock(getNameLock(pluginDesc.pluginName));
+	if (profile) {
+		waitSeconds += std::chrono::duration<double>(ExportProfiler::Clock::now() - lockStart).count();
+	}
+
+	// only the calls writing the plugin are serialized
+	auto lockExport = [this, profile, &waitSeconds]() {
+		const auto start = profile ? ExportProfiler::Clock::now() : ExportProfiler::Clock::time_point();
+		std::unique_lock<std::recursive_mutex> lock(m_exportMtx);
+		if (profile) {
+			waitSeconds += std::chrono::duration<double>(ExportProfiler::Clock::now() - start).count();
+		}
+		return lock;
+	};
+
 	const bool hasFrames = exporter_settings.settings_animation.use || exporter_settings.use_motion_blur;
 
 	// force replace off for animation, because repalce will wipe all animation data up until current frame
 	replace = hasFrames ? false : replace;
 
 	const bool inCache = m_pluginManager.inCache(pluginDesc);
-	const bool isDifferent = inCache ? m_pluginManager.differs(pluginDesc) : true;
+	const bool isDifferent = inCache ? m_pluginManager.differs(pluginDesc, descHash) : true;
 	const bool isDifferentId = inCache ? m_pluginManager.differsId(pluginDesc) : false;
 	AttrPlugin plg(pluginDesc.pluginName);
 
 	if (!inCache) {
-		plg = this->export_plugin_impl(pluginDesc);
-		m_pluginManager.updateCache(pluginDesc, current_scene_frame);
+		const std::string duplicate = this->find_duplicate_plugin(pluginDesc, descHash);
+		float frame;
+		{
+			auto lock = lockExport();
+			if (duplicate.empty()) {
+				plg = this->export_plugin_impl(pluginDesc);
+			}
+			frame = current_scene_frame;
+		}
+		m_pluginManager.updateCache(pluginDesc, std::move(descHash), frame);
 	} else if (replace || (inCache && isDifferent)) {
+		float frame;
 
 		if (isDifferentId) {
 			this->remove_plugin(pluginDesc.pluginName);
+			auto lock = lockExport();
 			plg = this->export_plugin_impl(pluginDesc);
+			frame = current_scene_frame;
 		} else {
 			if (!replace) {
 				// We need to export last exported data for the previous frame
@@ -93,18 +129,23 @@ AttrPlugin PluginExporter::export_plugin(const PluginDesc &pluginDesc, bool repl
 				//    - the last frame data was exported (cached one)
 				//    - the current data we export
 				// But actually it needs to interpolate between previous frame and current frame
+				const PluginDesc diff = m_pluginManager.differences(pluginDesc, descHash);
+
+				auto lock = lockExport();
 				if (m_pluginManager.storeData()) {
 					const auto cachedItem = m_pluginManager.fromCache(pluginDesc.pluginName);
 					// if the cached item is from previous frame - we don't need to write extra key frame now
 					if (current_scene_frame - cachedItem.frame > 1) {
 						// TODO: could this brake for subframes?
 						--current_scene_frame;
-						this->export_plugin_impl(PluginManager::diffWithPlugin(cachedItem.desc, pluginDesc));
+						this->export_plugin_impl(m_pluginManager.diffCachedWithHash(cachedItem.desc, descHash));
 						++current_scene_frame;
 					}
 				}
-				plg = this->export_plugin_impl(m_pluginManager.differences(pluginDesc));
+				plg = this->export_plugin_impl(diff);
+				frame = current_scene_frame;
 			} else {
+				auto lock = lockExport();
 				// we need replace when exporting to AppSDK
 				const auto state = this->get_commit_state();
 				if (state != CommitState::CommitAutoOff) {
@@ -125,13 +166,21 @@ AttrPlugin PluginExporter::export_plugin(const PluginDesc &pluginDesc, bool repl
 				if (state != CommitState::CommitAutoOff) {
 					this->set_commit_state(state);
 				}
+				frame = current_scene_frame;
 			}
 		}
 
-		m_pluginManager.updateCache(pluginDesc, current_scene_frame);
+		m_pluginManager.updateCache(pluginDesc, std::move(descHash), frame);
+	}
+
+	if (profile) {
+		const bool cacheHit = inCache && !isDifferent && !replace;
+		const double seconds = std::chrono::duration<double>(ExportProfiler::Clock::now() - profileStart).count() - waitSeconds;
+		m_profiler.add(ExportProfiler::Category::PluginType, pluginDesc.pluginID, seconds,
+		               cacheHit ? 0 : ExportProfiler::getDataSize(pluginDesc), cacheHit, waitSeconds);
 	}
 
-	return plg;
+	return resolve_plugin(plg);
 }
 
 void PluginExporter::set_commit_state(VRayBaseTypes::CommitAction ca)
@@ -141,20 +190,58 @@ void PluginExporter::set_commit_state(VRayBaseTypes::CommitAction ca)
 	}
 }
 
+namespace {
+
+/// Get the render channel holding Blender's render pass @name
+/// @return false if the pass is not supported
+bool getPassChannel(const std::string & name, RenderChannelType & channel)
+{
+	if (name == "Combined") {
+		channel = RenderChannelTypeNone;
+	} else if (name == "Depth") {
+		channel = RenderChannelTypeVfbZdepth;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+}
+
 RenderImage PluginExporter::get_pass(const std::string & name)
 {
 	RenderImage image;
+	RenderChannelType channel;
 
-	if (name == "Combined") {
-		image = get_image();
-	} else if (name == "Depth") {
-		image = get_render_channel(RenderChannelTypeVfbZdepth);
+	if (getPassChannel(name, channel)) {
+		image = channel == RenderChannelTypeNone ? get_image() : get_render_channel(channel);
 	}
 
 	return image;
 }
 
 
+RenderImageTiles PluginExporter::get_render_channel_tiles(RenderChannelType channelType)
+{
+	const RenderImage image = channelType == RenderChannelTypeNone ? get_image() : get_render_channel(channelType);
+
+	return RenderImageTiles::fromImage(image, {ImageRegion(ImageSize{image.w, image.h, image.channels})});
+}
+
+
+RenderImageTiles PluginExporter::get_pass_tiles(const std::string & name)
+{
+	RenderImageTiles tiles;
+	RenderChannelType channel;
+
+	if (getPassChannel(name, channel)) {
+		tiles = get_render_channel_tiles(channel);
+	}
+
+	return tiles;
+}
+
+
 PluginExporterPtr VRayForBlender::ExporterCreate(VRayForBlender::ExporterType type, const ExporterSettings & settings)
 {
 	PluginExporterPtr exporter{nullptr};
@@ -29,6 +29,7 @@
 #include "vfb_plugin_exporter_types.h"
 #include "vfb_plugin_manager.h"
 #include "vfb_render_image.h"
+#include "vfb_export_profiler.h"
 
 #include "RNA_blender_cpp.h"
 
@@ -105,6 +106,15 @@ public:
 	AttrPlugin           export_plugin(const PluginDesc &pluginDesc, bool replace = false, bool dontExport = false);
 	virtual void         replace_plugin(const std::string &, const std::string &) {};
 
+	/// Get the plugin which should be referenced instead of @plugin, exporters merging plugins with the same data override this
+	virtual AttrPlugin   resolve_plugin(const AttrPlugin &plugin) const { return plugin; }
+
+	/// Get the name of an exported plugin with the same data as @pluginDesc, to be referenced instead of exporting @pluginDesc
+	/// Called only for full plugin descriptions not in the cache, without holding the export lock
+	/// @descHash - hash of @pluginDesc from PluginManager::makeHash
+	/// @return - name of the plugin to reference, or empty string if @pluginDesc must be exported
+	virtual std::string  find_duplicate_plugin(const PluginDesc &, const PluginManager::PluginDescHash &) { return ""; }
+
 	virtual int          remove_plugin_impl(const std::string&) { return 0; }
 	int                  remove_plugin(const std::string&);
 
@@ -118,6 +128,11 @@ public:
 
 	RenderImage          get_pass(const std::string & name);
 
+	/// Get the regions of a render channel's image that changed since the previous call
+	/// Exporters not tracking updates return the whole image as a single region
+	virtual RenderImageTiles get_render_channel_tiles(RenderChannelType channelType);
+	RenderImageTiles     get_pass_tiles(const std::string & name);
+
 	virtual void         show_frame_buffer() {}
 	virtual void         hide_frame_buffer() {}
 	virtual void         set_render_mode(RenderMode) {}
@@ -126,6 +141,11 @@ public:
 	virtual void         set_render_region(int x, int y, int w, int h, bool crop) {}
 	virtual void         set_viewport_quality(int) {}
 
+	/// Choose the format of the viewport images for the current view, called before each viewport sync
+	virtual void         update_viewport_transport() {}
+	/// Get the multiplier of the viewport render size chosen by update_viewport_transport()
+	virtual float        get_viewport_scale() const { return 1.f; }
+
 	virtual void         set_callback_on_image_ready(ExpoterCallback cb) { callback_on_image_ready = cb; }
 	virtual void         set_callback_on_rt_image_updated(ExpoterCallback cb) { callback_on_rt_image_updated = cb; }
 	virtual void         set_callback_on_message_updated(UpdateMessageCb cb) { callback_on_message_update = cb; }
@@ -149,6 +169,7 @@ public:
 	bool                 getIgnorePluginExport() const { return ignorePluginExport; }
 
 	PluginManager       &getPluginManager() { return m_pluginManager; }
+	ExportProfiler      &getProfiler() { return m_profiler; }
 
 protected:
 	const ExporterSettings &exporter_settings;
@@ -167,8 +188,19 @@ protected:
 	CommitState          commit_state;
 	std::vector<PluginDesc> delayedPlugins; ///< Plugins delayed until last to be exported (exported on sync())
 
+	/// Number of locks the plugin names are spread over in export_plugin
+	static const int     NameLockCount = 64;
+
+	/// Get the lock serializing the exports of the plugin named @name
+	/// Cache checks and diffs of different plugins run in parallel, only export_plugin_impl calls are serialized with m_exportMtx
+	std::recursive_mutex &getNameLock(const std::string &name) {
+		return m_nameMtx[std::hash<std::string>()(name) % NameLockCount];
+	}
+
 	PluginManager        m_pluginManager;
-	std::recursive_mutex m_exportMtx;
+	ExportProfiler       m_profiler; ///< Export time and data size statistics, only collected when enabled
+	std::recursive_mutex m_exportMtx; ///< Serializes the calls writing plugins: export_plugin_impl, remove_plugin_impl, replace_plugin
+	std::recursive_mutex m_nameMtx[NameLockCount]; ///< Locks taken by plugin name before m_exportMtx, never after it
 
 };
 
@@ -21,6 +21,7 @@
 #include "vfb_params_json.h"
 #include "vfb_export_settings.h"
 #include "vfb_utils_string.h"
+#include "utils/cgr_hash.h"
 
 #include "BLI_fileops.h"
 #include "BLI_path_util.h"
@@ -30,10 +31,38 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/date_time.hpp>
+
+#include <algorithm>
 namespace fs = boost::filesystem;
 
 using namespace VRayForBlender;
 
+namespace {
+/// Get cost hint for serializing plugin, the size of the list data dominates everything else
+ThreadManager::Cost getPluginBlockCost(const PluginDesc &pluginDesc)
+{
+	ThreadManager::Cost cost = 1;
+	for (const auto & attr : pluginDesc.pluginAttrs) {
+		const AttrValue & value = attr.second.attrValue;
+		switch (value.type) {
+		case ValueTypeListInt: cost += value.as<AttrListInt>().getBytesCount(); break;
+		case ValueTypeListFloat: cost += value.as<AttrListFloat>().getBytesCount(); break;
+		case ValueTypeListVector: cost += value.as<AttrListVector>().getBytesCount(); break;
+		case ValueTypeListColor: cost += value.as<AttrListColor>().getBytesCount(); break;
+		case ValueTypeMapChannels:
+			for (const auto & channel : value.as<AttrMapChannels>().data) {
+				cost += channel.second.vertices.getBytesCount() + channel.second.faces.getBytesCount();
+			}
+			break;
+		case ValueTypeInstancer: cost += value.as<AttrInstancer>().data.getCount() * sizeof(AttrInstancer::Item); break;
+		default: break;
+		}
+	}
+	return cost;
+}
+
+}
+
 
 VrsceneExporter::VrsceneExporter(const ExporterSettings & settings)
 	: PluginExporter(settings)
@@ -91,6 +120,16 @@ void VrsceneExporter::set_export_file(VRayForBlender::ParamDesc::PluginType type
 				VFB_Assert(!"Failed to create PluginWriter for python file!");
 				return;
 			}
+			writer->setZipLevel(exporter_settings.export_zip_level);
+			// geometry file is only read when meshes are not exported, so keep it's side-car too
+			const bool writesFile = exporter_settings.export_meshes || type != ParamDesc::PluginType::PluginGeometry;
+			if (exporter_settings.export_file_format == ExporterSettings::ExportFormatBIN && writer->good() && writesFile) {
+				const std::string binaryFileName = fs::path(fileName).replace_extension(".vrbin").string();
+				std::shared_ptr<PluginBinaryFile> binaryFile(new PluginBinaryFile(binaryFileName));
+				if (binaryFile->good()) {
+					writer->setBinaryFile(binaryFile);
+				}
+			}
 			m_fileWritersMap[fileName] = writer;
 		} else {
 			writer = iter->second;
@@ -130,7 +169,7 @@ VrsceneExporter::~VrsceneExporter()
 void VrsceneExporter::init()
 {
 	getLog().info("Initting VrsceneExporter");
-	m_threadManager = ThreadManager::make(2);
+	m_threadManager = ThreadManager::make(ThreadManager::threadCountFor(exporter_settings.export_threads));
 	for (auto & w : m_fileWritersMap) {
 		w.second->setFormat(exporter_settings.export_file_format);
 	}
@@ -141,19 +180,56 @@ void VrsceneExporter::free()
 {
 	writeIncludes();
 	m_writers.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_geometryMtx);
+		m_geometryStore.clear();
+		m_geometryAliases.clear();
+	}
+	// writers flush all pending blocks when destroyed, so stop the threads after that
 	m_fileWritersMap.clear();
+	if (m_threadManager) {
+		m_threadManager->stop();
+	}
 }
 
 
 void VrsceneExporter::sync()
 {
 	PluginExporter::sync();
+	if (exporter_settings.use_pipelined_export && exporter_settings.settings_animation.use) {
+		// leave the frame to the writer threads while the next one is exported and
+		// only wait for the oldest blocks when over the memory budget
+		const ThreadManager::Cost budget = exporter_settings.export_pipeline_memory;
+		ThreadManager::Cost pending = 0;
+		std::vector<PluginWriter*> writers;
+		for (auto & writer : m_fileWritersMap) {
+			pending += writer.second->getPendingCost();
+			writers.push_back(writer.second.get());
+		}
+		if (pending <= budget) {
+			return;
+		}
+
+		getLog().debug("Pending export data %lld MB over budget %lld MB, flushing", (long long)(pending >> 20), (long long)(budget >> 20));
+		std::sort(writers.begin(), writers.end(), [](const PluginWriter *a, const PluginWriter *b) {
+			return a->getPendingCost() > b->getPendingCost();
+		});
+		for (PluginWriter *writer : writers) {
+			const ThreadManager::Cost over = pending - budget;
+			const ThreadManager::Cost before = writer->getPendingCost();
+			writer->blockFlushTo(before > over ? before - over : 0);
+			pending -= before - writer->getPendingCost();
+			if (pending <= budget) {
+				break;
+			}
+		}
+		return;
+	}
+
 	getLog().info("Flushing all data to files");
 	for (auto & writer : m_fileWritersMap) {
 		writer.second->blockFlushAll();
 	}
-
-	m_threadManager->stop();
 }
 
 void VrsceneExporter::writeIncludes()
@@ -166,7 +242,7 @@ void VrsceneExporter::writeIncludes()
 		getLog().error("Missing file for PluginSettings");
 		return;
 	}
-	*writerPtr << m_includesString;
+	writerPtr->writeStr(m_includesString.c_str());
 }
 
 
@@ -182,6 +258,39 @@ void VrsceneExporter::stop()
 }
 
 
+AttrPlugin VrsceneExporter::resolve_plugin(const AttrPlugin &plugin) const
+{
+	std::lock_guard<std::mutex> lock(m_geometryMtx);
+	const auto alias = m_geometryAliases.find(plugin.plugin);
+	if (alias == m_geometryAliases.end()) {
+		return plugin;
+	}
+	return AttrPlugin(alias->second, plugin.output);
+}
+
+
+std::string VrsceneExporter::find_duplicate_plugin(const PluginDesc &pluginDesc, const PluginManager::PluginDescHash &descHash)
+{
+	// plugin references are not animated, so a plugin merged on one frame would stay merged for all frames
+	// even if it's data diverges later, only merge for single frame exports
+	if (pluginDesc.pluginID != "GeomStaticMesh" || exporter_settings.settings_animation.use || exporter_settings.use_motion_blur) {
+		return "";
+	}
+
+	// the hash only picks the candidates, their cached data is compared as the hash is not unique
+	std::lock_guard<std::mutex> lock(m_geometryMtx);
+	std::vector<std::string> & candidates = m_geometryStore[descHash.m_allHash];
+	for (const std::string & candidate : candidates) {
+		if (candidate != pluginDesc.pluginName && m_pluginManager.sameAsCached(candidate, pluginDesc, descHash)) {
+			m_geometryAliases[pluginDesc.pluginName] = candidate;
+			return candidate;
+		}
+	}
+	candidates.push_back(pluginDesc.pluginName);
+	return "";
+}
+
+
 AttrPlugin VrsceneExporter::export_plugin_impl(const PluginDesc &pluginDesc)
 {
 	const std::string & name = pluginDesc.pluginName;
@@ -221,55 +330,57 @@ AttrPlugin VrsceneExporter::export_plugin_impl(const PluginDesc &pluginDesc)
 		}
 	}
 
-	PluginWriter & writer = *writerPtr;
 	// dont set frame for settings file when DR is off and seperate files is on and current file is Settings
 	const bool setFrame = writerType != ParamDesc::PluginSettings;
-
-	writer << pluginDesc.pluginID << " " << StripString(pluginDesc.pluginName) << " {\n";
+	float pluginFrame = INVALID_FRAME;
 	if (exporter_settings.settings_animation.use || exporter_settings.use_motion_blur) {
 		if (setFrame) {
-			writer.setAnimationFrame(this->current_scene_frame);
-		} else {
-			writer.setAnimationFrame(INVALID_FRAME);
+			pluginFrame = this->current_scene_frame;
 		}
 	}
 
-	const float writerFrame = writer.getAnimationFrame();
-	const ParamDesc::PluginParamDesc &desc = GetPluginDescription(pluginDesc.pluginID);
+	// attribute values hold their list data in shared pointers so this copy is cheap and keeps the data alive
+	writerPtr->addBlock([pluginDesc, pluginFrame](PluginBuffer & writer) {
+		writer << pluginDesc.pluginID << " " << StripString(pluginDesc.pluginName) << " {\n";
+		writer.setAnimationFrame(pluginFrame);
 
-	for (auto & attributePairs : pluginDesc.pluginAttrs) {
-		const PluginAttr & attr = attributePairs.second;
-		if (attr.attrValue.type == ValueTypeUnknown) {
-			continue;
-		}
+		const float writerFrame = writer.getAnimationFrame();
+		const ParamDesc::PluginParamDesc &desc = GetPluginDescription(pluginDesc.pluginID);
 
-		bool forceNoFrame = false;
-		const auto attrIter = desc.attributes.find(attr.attrName);
-		if (attrIter != desc.attributes.end()) {
-			// filepaths are not animated
-			if (attrIter->second.type == ParamDesc::AttrTypeDirpath || attrIter->second.type == ParamDesc::AttrTypeFilepath) {
-				forceNoFrame = true;
+		for (auto & attributePairs : pluginDesc.pluginAttrs) {
+			const PluginAttr & attr = attributePairs.second;
+			if (attr.attrValue.type == ValueTypeUnknown) {
+				continue;
 			}
-			// generic lists different from Instancer[2]::instances are not animated
-			if (attrIter->second.type == ParamDesc::AttrTypeList && !String::StartsWith(pluginDesc.pluginID, "Instancer")) {
-				forceNoFrame = true;
+
+			bool forceNoFrame = false;
+			const auto attrIter = desc.attributes.find(attr.attrName);
+			if (attrIter != desc.attributes.end()) {
+				// filepaths are not animated
+				if (attrIter->second.type == ParamDesc::AttrTypeDirpath || attrIter->second.type == ParamDesc::AttrTypeFilepath) {
+					forceNoFrame = true;
+				}
+				// generic lists different from Instancer[2]::instances are not animated
+				if (attrIter->second.type == ParamDesc::AttrTypeList && !String::StartsWith(pluginDesc.pluginID, "Instancer")) {
+					forceNoFrame = true;
+				}
 			}
-		}
 
-		bool restoreFrame = false;
-		if (forceNoFrame || (attr.time == INVALID_FRAME && writerFrame != INVALID_FRAME)) {
-			writer.setAnimationFrame(INVALID_FRAME);
-			restoreFrame = true;
-		}
+			bool restoreFrame = false;
+			if (forceNoFrame || (attr.time == INVALID_FRAME && writerFrame != INVALID_FRAME)) {
+				writer.setAnimationFrame(INVALID_FRAME);
+				restoreFrame = true;
+			}
 
-		writer << KVPair<AttrValue>(attr.attrName, attr.attrValue);
+			writer << KVPair<AttrValue>(attr.attrName, attr.attrValue);
 
-		if (restoreFrame) {
-			writer.setAnimationFrame(writerFrame);
+			if (restoreFrame) {
+				writer.setAnimationFrame(writerFrame);
+			}
 		}
-	}
 
-	writer << "}\n\n";
+		writer << "}\n\n";
+	}, getPluginBlockCost(pluginDesc));
 
 	return plugin;
 }
@@ -45,6 +45,8 @@ public:
 
 	virtual AttrPlugin  export_plugin_impl(const PluginDesc &pluginDesc);
 	virtual void        set_export_file(VRayForBlender::ParamDesc::PluginType type, PyObject *file);
+	virtual AttrPlugin  resolve_plugin(const AttrPlugin &plugin) const;
+	virtual std::string find_duplicate_plugin(const PluginDesc &pluginDesc, const PluginManager::PluginDescHash &descHash);
 private:
 	/// Open a file for the specified type and filepath
 	/// @param type - the plugin type for this file
@@ -63,6 +65,10 @@ private:
 	ThreadManager::Ptr            m_threadManager; ///< Pointer to the thread manager used by the file writers
 	std::string                   m_includesString; ///< Includes for separate file mode written in main .vrscene
 	std::string                   m_headerString; ///< Header comments string including export time and build hash
+
+	HashMap<MHash, std::vector<std::string>> m_geometryStore; ///< Maps the hash of exported GeomStaticMesh plugins to their names
+	HashMap<std::string, std::string> m_geometryAliases; ///< Maps skipped duplicate geometry to the plugin holding the same data
+	mutable std::mutex            m_geometryMtx; ///< Protects m_geometryStore and m_geometryAliases, they are used without the export lock
 };
 
 } // namespace VRayForBlender
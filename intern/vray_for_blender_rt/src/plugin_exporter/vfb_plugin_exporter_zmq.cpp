@@ -98,6 +98,7 @@ void ZmqExporter::ZmqRenderImage::update(const VRayBaseTypes::AttrImage &img, Zm
 				memset(pixels, 0, w * h * channels * sizeof(float));
 
 				resetUpdated();
+				markDirty(ImageRegion(ImageSize{w, h, channels}));
 			}
 		}
 
@@ -106,6 +107,12 @@ void ZmqExporter::ZmqRenderImage::update(const VRayBaseTypes::AttrImage &img, Zm
 
 		updateRegion(sourceImage, {img.x, img.y, img.width, img.height});
 
+		{
+			std::lock_guard<std::mutex> lock(exp->m_imgMutex);
+			// updateRegion writes rows bottom to top
+			markDirty(ImageRegion(img.x, h - img.y - img.height, img.width, img.height));
+		}
+
 	} else if (img.imageType == VRayBaseTypes::AttrImage::ImageType::JPG) {
 		int channels = 0;
 		float * imgData = jpegToPixelData(reinterpret_cast<unsigned char*>(img.data.get()), img.size, channels);
@@ -118,59 +125,39 @@ void ZmqExporter::ZmqRenderImage::update(const VRayBaseTypes::AttrImage &img, Zm
 			this->h = img.height;
 			delete[] pixels;
 			this->pixels = imgData;
+			markDirty(ImageRegion(ImageSize{w, h, channels}));
 		}
 	} else if (img.imageType == VRayBaseTypes::AttrImage::ImageType::RGBA_REAL ||
 		       img.imageType == VRayBaseTypes::AttrImage::ImageType::RGB_REAL ||
 		       img.imageType == VRayBaseTypes::AttrImage::ImageType::BW_REAL) {
 
 		const float * imgData = reinterpret_cast<const float *>(img.data.get());
-		float * myImage = nullptr;
 		int channels = 0;
 
 		switch (img.imageType) {
 		case VRayBaseTypes::AttrImage::ImageType::RGBA_REAL:
 			channels = 4;
-			myImage = new float[img.width * img.height * channels];
-			memcpy(myImage, imgData, img.width * img.height * channels * sizeof(float));
-
 			break;
 		case VRayBaseTypes::AttrImage::ImageType::RGB_REAL:
 			channels = 3;
-			myImage = new float[img.width * img.height * channels];
-
-			for (int c = 0; c < img.width * img.height; ++c) {
-				const float * source = imgData + (c * 4);
-				float * dest = myImage + (c * channels);
-
-				dest[0] = source[0];
-				dest[1] = source[1];
-				dest[2] = source[2];
-			}
-
 			break;
 		case VRayBaseTypes::AttrImage::ImageType::BW_REAL:
 			channels = 1;
-			myImage = new float[img.width * img.height * channels];
-
-			for (int c = 0; c < img.width * img.height; ++c) {
-				const float * source = imgData + (c * 4);
-				float * dest = myImage + (c * channels);
-
-				dest[0] = source[0];
-			}
-
 			break;
 		default:
 			getLog().warning("MISSING IMAGE FORMAT CONVERTION FOR %d", img.imageType);
 		}
 
-		{
+		if (channels) {
+			// convert into the spare buffer so readers are blocked only for the swap
+			float * myImage = spareBuffer.get(img.width * img.height * channels);
+			convertImage(myImage, channels, imgData, img.width, img.height, fixImage,
+			             fixImage ? ImageRegion::Options::FROM_RENDERER : ImageRegion::Options::NONE);
+			fixImage = false;
+
 			std::lock_guard<std::mutex> lock(exp->m_imgMutex);
-			this->channels = channels;
-			this->w = img.width;
-			this->h = img.height;
-			delete[] pixels;
-			this->pixels = myImage;
+			spareBuffer.swap(*this, img.width, img.height, channels);
+			markDirty(ImageRegion(ImageSize{w, h, channels}));
 		}
 	}
 
@@ -181,6 +168,33 @@ void ZmqExporter::ZmqRenderImage::update(const VRayBaseTypes::AttrImage &img, Zm
 	}
 }
 
+void ZmqExporter::ZmqRenderImage::markDirty(const ImageRegion &region)
+{
+	const int imagePixels = w * h;
+	if (dirtyPixels >= imagePixels) {
+		// the whole image is already marked
+		return;
+	}
+
+	const int regionPixels = region.w * region.h;
+	if (dirtyPixels + regionPixels >= imagePixels) {
+		// overlapping regions would copy more than the whole image
+		dirtyRegions.assign(1, ImageRegion(0, 0, w, h));
+		dirtyPixels = imagePixels;
+	} else {
+		dirtyRegions.push_back(region);
+		dirtyPixels += regionPixels;
+	}
+}
+
+RenderImageTiles ZmqExporter::ZmqRenderImage::takeTiles()
+{
+	RenderImageTiles tiles = RenderImageTiles::fromImage(*this, dirtyRegions);
+	dirtyRegions.clear();
+	dirtyPixels = 0;
+	return tiles;
+}
+
 
 ZmqExporter::ZmqExporter(const ExporterSettings & settings)
     : PluginExporter(settings)
@@ -189,6 +203,8 @@ ZmqExporter::ZmqExporter(const ExporterSettings & settings)
     , m_isAborted(false)
     , m_started(false)
     , m_exportedCount(0)
+    , m_viewportScale(1.f)
+    , m_sizeScale(1.f)
 {
 	checkZmqClient();
 }
@@ -226,6 +242,21 @@ RenderImage ZmqExporter::get_render_channel(RenderChannelType channelType) {
 	return img;
 }
 
+RenderImageTiles ZmqExporter::get_render_channel_tiles(RenderChannelType channelType) {
+	RenderImageTiles tiles;
+
+	auto imgIter = m_layerImages.find(channelType);
+	if (imgIter != m_layerImages.end()) {
+		std::unique_lock<std::mutex> lock(m_imgMutex);
+		imgIter = m_layerImages.find(channelType);
+
+		if (imgIter != m_layerImages.end() && imgIter->second.pixels) {
+			tiles = imgIter->second.takeTiles();
+		}
+	}
+	return tiles;
+}
+
 RenderImage ZmqExporter::get_image() {
 	return get_render_channel(RenderChannelType::RenderChannelTypeNone);
 }
@@ -270,6 +301,9 @@ void ZmqExporter::zmqCallback(const VRayMessage & message, ZmqClient *) {
 		bool rtImageUpdate = false;
 		for (const auto &img : set->images) {
 			m_layerImages[img.first].update(img.second, this, !is_viewport);
+			if (is_viewport && img.first == RenderChannelType::RenderChannelTypeNone) {
+				m_transport.imageReceived(ViewportTransport::Clock::now());
+			}
 			// for result buckets use on bucket ready, otherwise rt image updated callback
 			if (img.first == RenderChannelType::RenderChannelTypeNone && img.second.isBucket() && this->callback_on_bucket_ready) {
 				this->callback_on_bucket_ready(img.second);
@@ -347,17 +381,17 @@ void ZmqExporter::init()
 				}
 			}
 
-			m_client->send(VRayMessage::msgRendererActionInit(type, drflags));
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode)));
+			send(VRayMessage::msgRendererActionInit(type, drflags));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode)));
 
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(RenderChannelType::RenderChannelTypeNone)));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(RenderChannelType::RenderChannelTypeNone)));
 			if (!is_viewport && !exporter_settings.settings_animation.use) {
-				m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(RenderChannelType::RenderChannelTypeVfbRealcolor)));
+				send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(RenderChannelType::RenderChannelTypeVfbRealcolor)));
 			}
 
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb));
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality));
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type)));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type)));
 
 			if (exporter_settings.settings_dr.use) { 
 				const std::vector<std::string> & hostItems = exporter_settings.settings_dr.hosts;
@@ -368,7 +402,7 @@ void ZmqExporter::init()
 					hostsStr.push_back(';');
 				}
 				hostsStr.pop_back(); // remove last delimiter - ;
-				m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ResetsHosts, hostsStr));
+				send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ResetsHosts, hostsStr));
 			}
 
 			m_cachedValues.show_vfb = exporter_settings.show_vfb;
@@ -406,18 +440,23 @@ void ZmqExporter::checkZmqClient()
 void ZmqExporter::free()
 {
 	checkZmqClient();
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Free));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Free));
+	logUpdateStats("Free");
+
+	std::lock_guard<std::mutex> lock(m_createdMutex);
+	m_createdPlugins.clear();
 }
 
 void ZmqExporter::clear_frame_data(float upTo)
 {
 	checkZmqClient();
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ClearFrameValues, upTo));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ClearFrameValues, upTo));
 }
 
 void ZmqExporter::wait_for_server()
 {
 	checkZmqClient();
+	flushPluginUpdates();
 	m_client->waitForMessages();
 }
 
@@ -431,10 +470,13 @@ void ZmqExporter::sync()
 	}
 
 	checkZmqClient();
-	CHECK_UPDATE(show_vfb, m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb)));
-	CHECK_UPDATE(viewport_image_quality, m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality)));
-	CHECK_UPDATE(viewport_image_type, m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type))));
-	CHECK_UPDATE(render_mode, m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode))));
+	CHECK_UPDATE(show_vfb, send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb)));
+	if (!exporter_settings.use_viewport_adaptive) {
+		// otherwise the format is sent by update_viewport_transport
+		CHECK_UPDATE(viewport_image_quality, send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality)));
+		CHECK_UPDATE(viewport_image_type, send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type))));
+	}
+	CHECK_UPDATE(render_mode, send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode))));
 #undef CHECK_UPDATE
 	// call commit explicitly else will often commit before calling startSync which is not needed
 	// set_commit_state(CommitAction::CommitNow);
@@ -445,7 +487,7 @@ void ZmqExporter::set_current_frame(float frame)
 	if (frame != current_scene_frame) {
 		current_scene_frame = frame;
 		checkZmqClient();
-		m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCurrentFrame, frame));
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCurrentFrame, frame));
 	}
 }
 
@@ -454,21 +496,52 @@ void ZmqExporter::set_render_region(int x, int y, int w, int h, bool crop)
 	checkZmqClient();
 	const AttrListInt region({x, y, w, h});
 	if (crop) {
-		m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCropRegion, region));
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCropRegion, region));
 	} else {
-		m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderRegion, region));
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderRegion, region));
 	}
 }
 
 void ZmqExporter::set_render_size(const int &w, const int &h)
 {
 	std::unique_lock<std::mutex> lock(m_imgMutex);
+	// a resize for a new scale chosen by m_transport is not a view change, else the view never goes idle
+	const bool scaleChanged = m_sizeScale != m_viewportScale;
+	m_sizeScale = m_viewportScale;
 	if (w != m_cachedValues.renderWidth || h != m_cachedValues.renderHeight) {
 		m_cachedValues.renderWidth = w;
 		m_cachedValues.renderHeight = h;
 		checkZmqClient();
-		m_client->send(VRayMessage::msgRendererResize(w, h));
+		send(VRayMessage::msgRendererResize(w, h));
+		if (!scaleChanged) {
+			m_transport.viewChanged(ViewportTransport::Clock::now());
+		}
+	}
+}
+
+void ZmqExporter::update_viewport_transport()
+{
+	if (!exporter_settings.use_viewport_adaptive) {
+		m_viewportScale = 1.f;
+		return;
+	}
+
+	const ViewportTransport::Format preferred(exporter_settings.viewport_image_type, exporter_settings.viewport_image_quality, 1.f);
+	m_transport.setPreferred(preferred, 1.f / exporter_settings.viewport_target_fps);
+
+	const ViewportTransport::Format format = m_transport.getFormat(ViewportTransport::Clock::now());
+
+	checkZmqClient();
+	if (m_cachedValues.viewport_image_quality != format.quality) {
+		m_cachedValues.viewport_image_quality = format.quality;
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, format.quality));
+	}
+	if (m_cachedValues.viewport_image_type != format.type) {
+		m_cachedValues.viewport_image_type = format.type;
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(format.type)));
 	}
+	// applied by the next sync_view as a change of the render size
+	m_viewportScale = format.scale;
 }
 
 void ZmqExporter::set_camera_plugin(const std::string &pluginName)
@@ -477,7 +550,7 @@ void ZmqExporter::set_camera_plugin(const std::string &pluginName)
 		m_isDirty = true;
 		checkZmqClient();
 		m_cachedValues.activeCamera = pluginName;
-		m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCurrentCamera, pluginName));
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCurrentCamera, pluginName));
 	}
 }
 
@@ -487,13 +560,15 @@ void ZmqExporter::set_commit_state(VRayBaseTypes::CommitAction ca)
 		if (ca != commit_state) {
 			commit_state = ca;
 			checkZmqClient();
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCommitAction, static_cast<int>(ca)));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCommitAction, static_cast<int>(ca)));
 		}
 	} else {
 		if (m_isDirty) {
 			checkZmqClient();
-			m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCommitAction, static_cast<int>(ca)));
+			send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetCommitAction, static_cast<int>(ca)));
 			m_isDirty = false;
+			m_transport.viewChanged(ViewportTransport::Clock::now());
+			logUpdateStats("Commit");
 		}
 	}
 }
@@ -502,25 +577,28 @@ void ZmqExporter::start()
 {
 	checkZmqClient();
 	m_started = true;
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Start));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Start));
 }
 
 void ZmqExporter::reset()
 {
 	// TODO: try with clear values up to time
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Reset));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Reset));
 
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb));
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality));
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type)));
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode)));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetVfbShow, exporter_settings.show_vfb));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetQuality, exporter_settings.viewport_image_quality));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetViewportImageFormat, static_cast<int>(exporter_settings.viewport_image_type)));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::SetRenderMode, static_cast<int>(exporter_settings.render_mode)));
 
 	m_cachedValues = {}; // reset cache
+
+	std::lock_guard<std::mutex> lock(m_createdMutex);
+	m_createdPlugins.clear();
 }
 
 void ZmqExporter::stop()
 {
-	m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Stop));
+	send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::Stop));
 }
 
 void ZmqExporter::export_vrscene(const std::string &filepath)
@@ -536,7 +614,7 @@ void ZmqExporter::export_vrscene(const std::string &filepath)
 		getLog().error("Failed to create directory \"%s\": %s", filepath.c_str(), code.message().c_str());
 	} else {
 		checkZmqClient();
-		m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ExportScene, filepath));
+		send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::ExportScene, filepath));
 		m_client->waitForMessages();
 	}
 }
@@ -545,7 +623,12 @@ int ZmqExporter::remove_plugin_impl(const std::string &name)
 {
 	m_isDirty = true;
 	checkZmqClient();
-	m_client->send(VRayMessage::msgPluginAction(name, VRayMessage::PluginAction::Remove));
+	m_pluginUpdates.dropPlugin(name);
+	send(VRayMessage::msgPluginAction(name, VRayMessage::PluginAction::Remove));
+	{
+		std::lock_guard<std::mutex> lock(m_createdMutex);
+		m_createdPlugins.erase(name);
+	}
 	return PluginExporter::remove_plugin_impl(name);
 }
 
@@ -553,7 +636,7 @@ void ZmqExporter::replace_plugin(const std::string & oldPlugin, const std::strin
 {
 	m_isDirty = true;
 	checkZmqClient();
-	m_client->send(VRayMessage::msgPluginReplace(oldPlugin, newPlugin));
+	send(VRayMessage::msgPluginReplace(oldPlugin, newPlugin));
 }
 
 
@@ -588,23 +671,60 @@ AttrPlugin ZmqExporter::export_plugin_impl(const PluginDesc & pluginDesc)
 
 		for (int c = 0; c < sizeof(channelMap) / sizeof(channelMap[0]); ++c) {
 			if (pluginDesc.pluginID == channelMap[c].first) {
-				m_client->send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(channelMap[c].second)));
+				send(VRayMessage::msgRendererAction(VRayMessage::RendererAction::GetImage, static_cast<int>(channelMap[c].second)));
 			}
 		}
 	}
 
-	m_client->send(VRayMessage::msgPluginCreate(name, pluginDesc.pluginID));
+	bool isNew = false;
+	{
+		std::lock_guard<std::mutex> lock(m_createdMutex);
+		isNew = m_createdPlugins.insert(name).second;
+	}
+	if (isNew) {
+		// the properties are queued so the plugin has to exist before they are flushed
+		m_client->send(VRayMessage::msgPluginCreate(name, pluginDesc.pluginID));
+	}
 
 	for (auto & attributePairs : pluginDesc.pluginAttrs) {
 		const PluginAttr & attr = attributePairs.second;
 		if (attr.attrValue.getType() != ValueTypeUnknown) {
-			m_client->send(VRayMessage::msgPluginSetProperty(name, attr.attrName, attr.attrValue));
+			m_pluginUpdates.push(name, attr.attrName, attr.attrValue);
 		}
 	}
 
+	if (commit_state != CommitAction::CommitAutoOff) {
+		// the renderer applies changes immediately, so should we
+		flushPluginUpdates();
+	}
+
 	return plugin;
 }
 
+void ZmqExporter::send(const VRayMessage &message)
+{
+	// queued property updates must reach the renderer before anything that may depend on them
+	flushPluginUpdates();
+	m_client->send(message);
+}
+
+void ZmqExporter::flushPluginUpdates()
+{
+	m_pluginUpdates.flush([this](const std::string &plugin, const std::string &attr, const AttrValue &value) {
+		m_client->send(VRayMessage::msgPluginSetProperty(plugin, attr, value));
+	});
+}
+
+void ZmqExporter::logUpdateStats(const char *when) const
+{
+	const PluginUpdateQueue::Stats stats = m_pluginUpdates.getStats();
+	getLog().debug("%s: %llu property updates sent in %llu flushes (%llu KB), %llu coalesced, %llu dropped for removed plugins",
+	               when,
+	               static_cast<unsigned long long>(stats.sent), static_cast<unsigned long long>(stats.flushes),
+	               static_cast<unsigned long long>(stats.bytes >> 10), static_cast<unsigned long long>(stats.coalesced),
+	               static_cast<unsigned long long>(stats.dropped));
+}
+
 int ZmqExporter::getExportedPluginsCount() const
 {
 	return m_exportedCount;
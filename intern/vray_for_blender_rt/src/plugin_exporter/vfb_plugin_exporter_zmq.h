@@ -22,6 +22,8 @@
 
 #include "vfb_plugin_exporter.h"
 #include "vfb_utils_object.h"
+#include "vfb_viewport_transport.h"
+#include "vfb_plugin_update_queue.h"
 
 #include "zmq_wrapper.hpp"
 #include "zmq_message.hpp"
@@ -53,6 +55,15 @@ public:
 	struct ZmqRenderImage:
 		public RenderImage {
 		void update(const VRayBaseTypes::AttrImage &img, ZmqExporter * exp, bool fixImage);
+
+		/// Add @region to the regions updated since the last takeTiles(), must be called with m_imgMutex locked
+		void markDirty(const ImageRegion &region);
+		/// Copy the updated regions and clear them, must be called with m_imgMutex locked
+		RenderImageTiles takeTiles();
+
+		RenderImageBuffer        spareBuffer; ///< Reused for full image updates
+		std::vector<ImageRegion> dirtyRegions; ///< Regions updated since the last takeTiles()
+		int                      dirtyPixels = 0; ///< Number of pixels in dirtyRegions
 	};
 
 	typedef HashMap<RenderChannelType, ZmqRenderImage, std::hash<int>> ImageMap;
@@ -79,8 +90,11 @@ public:
 
 	virtual RenderImage get_image();
 	virtual RenderImage get_render_channel(RenderChannelType channelType);
+	virtual RenderImageTiles get_render_channel_tiles(RenderChannelType channelType) override;
 	virtual void        set_render_size(const int &w, const int &h);
 	virtual void        set_render_region(int x, int y, int w, int h, bool crop);
+	virtual void        update_viewport_transport() override;
+	virtual float       get_viewport_scale() const override { return m_viewportScale; }
 	virtual void        set_camera_plugin(const std::string &pluginName);
 	virtual void        set_commit_state(VRayBaseTypes::CommitAction ca);
 
@@ -94,6 +108,13 @@ private:
 	void                checkZmqClient();
 	void                zmqCallback(const VRayMessage & message, ZmqClient * client);
 
+	/// Send @message after the queued property updates
+	void                send(const VRayMessage &message);
+	/// Send the queued property updates
+	void                flushPluginUpdates();
+	/// Log the counters of m_pluginUpdates, @when is the log message prefix
+	void                logUpdateStats(const char *when) const;
+
 private:
 	using ImageType = VRayBaseTypes::AttrImage::ImageType;
 
@@ -123,6 +144,14 @@ private:
 	ImageMap            m_layerImages;
 
 	ValueCache          m_cachedValues;
+
+	PluginUpdateQueue   m_pluginUpdates; ///< Property updates waiting for the next commit or other message
+	std::mutex          m_createdMutex;
+	StringHashSet       m_createdPlugins; ///< Plugins created on the server, so updates don't create them again
+
+	ViewportTransport   m_transport; ///< Adapts the viewport image format if use_viewport_adaptive is set
+	float               m_viewportScale; ///< Render size multiplier chosen by m_transport
+	float               m_sizeScale; ///< m_viewportScale when the render size was last set
 };
 } // namespace VRayForBlender
 
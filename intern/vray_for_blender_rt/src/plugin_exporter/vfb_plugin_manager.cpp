@@ -20,6 +20,8 @@
 #include "vfb_plugin_exporter.h"
 #include "utils/cgr_hash.h"
 #include <iterator>
+#include <cstring>
+#include <chrono>
 
 using namespace VRayForBlender;
 using namespace std;
@@ -118,41 +120,175 @@ MHash getAttrHash(const AttrValue & value, const MHash seed = 42) {
 	}
 	return false;
 }
+
+template <typename T>
+bool listsEqual(const AttrList<T> &a, const AttrList<T> &b) {
+	if (a.getCount() != b.getCount()) {
+		return false;
+	}
+	return a.empty() || a.getData() == b.getData() || memcmp(*a, *b, a.getBytesCount()) == 0;
+}
+
+template <typename T>
+bool bytesEqual(const T &a, const T &b) {
+	return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+/// Compare the values of two attributes, values of types that are not compared are never equal
+bool attrValuesEqual(const AttrValue &a, const AttrValue &b) {
+	if (a.type != b.type) {
+		return false;
+	}
+	switch (a.type) {
+		case ValueTypeInt:
+			return a.as<AttrSimpleType<int>>().value == b.as<AttrSimpleType<int>>().value;
+		case ValueTypeFloat:
+			return bytesEqual(a.as<AttrSimpleType<float>>().value, b.as<AttrSimpleType<float>>().value);
+		case ValueTypeString:
+			return a.as<AttrSimpleType<std::string>>().value == b.as<AttrSimpleType<std::string>>().value;
+		case ValueTypeColor:
+			return bytesEqual(a.as<AttrColor>(), b.as<AttrColor>());
+		case ValueTypeAColor:
+			return bytesEqual(a.as<AttrAColor>(), b.as<AttrAColor>());
+		case ValueTypeVector:
+			return bytesEqual(a.as<AttrVector>(), b.as<AttrVector>());
+		case ValueTypeTransform:
+			return bytesEqual(a.as<AttrTransform>(), b.as<AttrTransform>());
+		case ValueTypeMatrix:
+			return bytesEqual(a.as<AttrMatrix>(), b.as<AttrMatrix>());
+		case ValueTypePlugin:
+			return a.as<AttrPlugin>().plugin == b.as<AttrPlugin>().plugin && a.as<AttrPlugin>().output == b.as<AttrPlugin>().output;
+		case ValueTypeListInt:
+			return listsEqual(a.as<AttrListInt>(), b.as<AttrListInt>());
+		case ValueTypeListFloat:
+			return listsEqual(a.as<AttrListFloat>(), b.as<AttrListFloat>());
+		case ValueTypeListVector:
+			return listsEqual(a.as<AttrListVector>(), b.as<AttrListVector>());
+		case ValueTypeListColor:
+			return listsEqual(a.as<AttrListColor>(), b.as<AttrListColor>());
+		case ValueTypeListString: {
+			const AttrListString &aList = a.as<AttrListString>();
+			const AttrListString &bList = b.as<AttrListString>();
+			return aList.getCount() == bList.getCount() && (aList.empty() || *aList.getData() == *bList.getData());
+		}
+		case ValueTypeMapChannels: {
+			const auto &aData = a.as<AttrMapChannels>().data;
+			const auto &bData = b.as<AttrMapChannels>().data;
+			if (aData.size() != bData.size()) {
+				return false;
+			}
+			for (const auto &channel : aData) {
+				const auto other = bData.find(channel.first);
+				if (other == bData.end() ||
+				    channel.second.name != other->second.name ||
+				    !listsEqual(channel.second.vertices, other->second.vertices) ||
+				    !listsEqual(channel.second.faces, other->second.faces)) {
+					return false;
+				}
+			}
+			return true;
+		}
+		default:
+			break;
+	}
+	return false;
+}
+}
+
+PluginManager::ReadLock PluginManager::lockRead(const Shard &shard)
+{
+	shard.m_stats.m_reads.fetch_add(1, std::memory_order_relaxed);
+	ReadLock lock(shard.m_lock, boost::try_to_lock);
+	if (!lock.owns_lock()) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		lock.lock();
+		const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start);
+		shard.m_stats.m_contended.fetch_add(1, std::memory_order_relaxed);
+		shard.m_stats.m_waitNs.fetch_add(waited.count(), std::memory_order_relaxed);
+	}
+	return lock;
+}
+
+PluginManager::WriteLock PluginManager::lockWrite(const Shard &shard)
+{
+	shard.m_stats.m_writes.fetch_add(1, std::memory_order_relaxed);
+	WriteLock lock(shard.m_lock, boost::try_to_lock);
+	if (!lock.owns_lock()) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		lock.lock();
+		const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start);
+		shard.m_stats.m_contended.fetch_add(1, std::memory_order_relaxed);
+		shard.m_stats.m_waitNs.fetch_add(waited.count(), std::memory_order_relaxed);
+	}
+	return lock;
+}
+
+void PluginManager::logLockStats(const char *context) const
+{
+	uint64_t reads = 0, writes = 0, contended = 0, waitNs = 0, maxShardContended = 0;
+	int busiestShard = 0;
+	for (int c = 0; c < ShardCount; ++c) {
+		const LockStats & stats = m_shards[c].m_stats;
+		const uint64_t shardContended = stats.m_contended.exchange(0, std::memory_order_relaxed);
+		reads += stats.m_reads.exchange(0, std::memory_order_relaxed);
+		writes += stats.m_writes.exchange(0, std::memory_order_relaxed);
+		waitNs += stats.m_waitNs.exchange(0, std::memory_order_relaxed);
+		contended += shardContended;
+		if (shardContended > maxShardContended) {
+			maxShardContended = shardContended;
+			busiestShard = c;
+		}
+	}
+
+	if (reads + writes == 0) {
+		return;
+	}
+
+	getLog().info("Plugin cache locks (%s): %llu reads, %llu writes, %llu contended (%.2f%%), %.3f ms waiting, busiest shard %d with %llu contended",
+	              context,
+	              static_cast<unsigned long long>(reads),
+	              static_cast<unsigned long long>(writes),
+	              static_cast<unsigned long long>(contended),
+	              100.0 * contended / (reads + writes),
+	              waitNs / 1e6,
+	              busiestShard,
+	              static_cast<unsigned long long>(maxShardContended));
 }
 
 bool PluginManager::inCache(const std::string &name) const
 {
-	lock_guard<mutex> l(m_cacheLock);
-	return m_cache.find(name) != m_cache.end();
+	const Shard & shard = m_shards[getShardIndex(name)];
+	auto l = lockRead(shard);
+	return shard.m_cache.find(name) != shard.m_cache.end();
 }
 
 bool PluginManager::inCache(const PluginDesc &pluginDesc) const
 {
-	lock_guard<mutex> l(m_cacheLock);
-	return m_cache.find(pluginDesc.pluginName) != m_cache.end();
+	return inCache(pluginDesc.pluginName);
 }
 
 void PluginManager::remove(const std::string &pluginName)
 {
-	lock_guard<mutex> l(m_cacheLock);
-	m_cache.erase(pluginName);
+	Shard & shard = m_shards[getShardIndex(pluginName)];
+	auto l = lockWrite(shard);
+	shard.m_cache.erase(pluginName);
 }
 
 void PluginManager::remove(const PluginDesc &pluginDesc)
 {
-	lock_guard<mutex> l(m_cacheLock);
-	m_cache.erase(pluginDesc.pluginName);
+	remove(pluginDesc.pluginName);
 }
 
-std::pair<bool, PluginDesc> PluginManager::diffWithCache(const PluginDesc &pluginDesc, bool buildDiff) const 
+std::pair<bool, PluginDesc> PluginManager::diffWithCache(const PluginDesc &pluginDesc, const PluginDescHash &descHash, bool buildDiff) const
 {
-	lock_guard<mutex> l(m_cacheLock);
 	const std::string & key = pluginDesc.pluginName;
-	auto cacheEntry = m_cache.find(key);
+	const Shard & shard = m_shards[getShardIndex(key)];
+	auto l = lockRead(shard);
+	auto cacheEntry = shard.m_cache.find(key);
 
 	PluginDesc res(pluginDesc.pluginName, pluginDesc.pluginID);
 
-	if (cacheEntry == m_cache.end()) {
+	if (cacheEntry == shard.m_cache.end()) {
 		return std::make_pair(true, res);
 	}
 
@@ -160,8 +296,6 @@ std::pair<bool, PluginDesc> PluginManager::diffWithCache(const PluginDesc &plugi
 		return std::make_pair(true, res);
 	}
 
-	const auto & descHash = makeHash(pluginDesc);
-
 	if (descHash.m_allHash != cacheEntry->second.m_allHash) {
 		if (!buildDiff) {
 			return std::make_pair(true, res);
@@ -201,10 +335,35 @@ std::pair<bool, PluginDesc> PluginManager::diffWithCache(const PluginDesc &plugi
 	return std::make_pair(false, res);
 }
 
+bool PluginManager::sameAsCached(const std::string &name, const PluginDesc &pluginDesc, const PluginDescHash &descHash) const
+{
+	VFB_Assert(m_storeData && "PluginManager::sameAsCached called when m_storeData == false");
+	const Shard & shard = m_shards[getShardIndex(name)];
+	auto l = lockRead(shard);
+	const auto cacheEntry = shard.m_cache.find(name);
+	if (cacheEntry == shard.m_cache.end() || cacheEntry->second.m_allHash != descHash.m_allHash) {
+		return false;
+	}
+
+	const PluginDesc & cached = cacheEntry->second.m_desc;
+	if (cached.pluginID != pluginDesc.pluginID || cached.pluginAttrs.size() != pluginDesc.pluginAttrs.size()) {
+		return false;
+	}
+	for (const auto & attr : pluginDesc.pluginAttrs) {
+		const PluginAttr * cachedAttr = cached.get(attr.first);
+		if (!cachedAttr || !attrValuesEqual(attr.second.attrValue, cachedAttr->attrValue)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 bool PluginManager::differsId(const PluginDesc &pluginDesc) const
 {
-	const auto iter = m_cache.find(pluginDesc.pluginName);
-	if (iter == m_cache.end()) {
+	const Shard & shard = m_shards[getShardIndex(pluginDesc.pluginName)];
+	auto l = lockRead(shard);
+	const auto iter = shard.m_cache.find(pluginDesc.pluginName);
+	if (iter == shard.m_cache.end()) {
 		return false;
 	}
 
@@ -213,12 +372,22 @@ bool PluginManager::differsId(const PluginDesc &pluginDesc) const
 
 bool PluginManager::differs(const PluginDesc &pluginDesc) const
 {
-	return diffWithCache(pluginDesc, false).first;
+	return differs(pluginDesc, makeHash(pluginDesc));
+}
+
+bool PluginManager::differs(const PluginDesc &pluginDesc, const PluginDescHash &descHash) const
+{
+	return diffWithCache(pluginDesc, descHash, false).first;
 }
 
 PluginDesc PluginManager::differences(const PluginDesc &pluginDesc) const
 {
-	return diffWithCache(pluginDesc, true).second;
+	return differences(pluginDesc, makeHash(pluginDesc));
+}
+
+PluginDesc PluginManager::differences(const PluginDesc &pluginDesc, const PluginDescHash &descHash) const
+{
+	return diffWithCache(pluginDesc, descHash, true).second;
 }
 
 PluginManager::PluginDescHash PluginManager::makeHash(const PluginDesc &pluginDesc) const
@@ -237,21 +406,45 @@ PluginManager::PluginDescHash PluginManager::makeHash(const PluginDesc &pluginDe
 	return hash;
 }
 
+PluginManager::FramePluginDesc PluginManager::fromCache(const std::string &name)
+{
+	VFB_Assert(m_storeData && "PluginManager::fromCache called when m_storeData == false");
+	Shard & shard = m_shards[getShardIndex(name)];
+	{
+		auto l = lockRead(shard);
+		auto iter = shard.m_cache.find(name);
+		if (iter != shard.m_cache.end()) {
+			return { iter->second.m_desc, iter->second.m_frame };
+		}
+	}
+	VFB_Assert(!"PluginManager::fromCache() called with NON cache plugin name!");
+	auto l = lockWrite(shard);
+	auto & item = shard.m_cache[name];
+	return { item.m_desc, item.m_frame };
+}
+
 void PluginManager::updateCache(const PluginDesc &desc, float frame)
 {
-	lock_guard<mutex> l(m_cacheLock);
-	auto hashedDesc = makeHash(desc);
+	updateCache(desc, makeHash(desc), frame);
+}
+
+void PluginManager::updateCache(const PluginDesc &desc, PluginDescHash descHash, float frame)
+{
 	if (m_storeData) {
-		hashedDesc.m_desc = desc;
-		hashedDesc.m_frame = frame;
+		descHash.m_desc = desc;
+		descHash.m_frame = frame;
 	}
-	m_cache[desc.pluginName] = hashedDesc;
+	Shard & shard = m_shards[getShardIndex(desc.pluginName)];
+	auto l = lockWrite(shard);
+	shard.m_cache[desc.pluginName] = std::move(descHash);
 }
 
 void PluginManager::clear()
 {
-	lock_guard<mutex> l(m_cacheLock);
-	m_cache.clear();
+	for (Shard & shard : m_shards) {
+		auto l = lockWrite(shard);
+		shard.m_cache.clear();
+	}
 }
 
 PluginDesc PluginManager::diffWithPlugin(const PluginDesc &source, const PluginDesc &filter)
@@ -269,3 +462,30 @@ PluginDesc PluginManager::diffWithPlugin(const PluginDesc &source, const PluginD
 
 	return result;
 }
+
+PluginDesc PluginManager::diffCachedWithHash(const PluginDesc &source, const PluginDescHash &filterHash) const
+{
+	PluginDesc result(source.pluginName, source.pluginID);
+
+	const Shard & shard = m_shards[getShardIndex(source.pluginName)];
+	auto l = lockRead(shard);
+	const auto cacheEntry = shard.m_cache.find(source.pluginName);
+	if (cacheEntry == shard.m_cache.end()) {
+		VFB_Assert(!"PluginManager::diffCachedWithHash() called with NON cache plugin!");
+		return result;
+	}
+
+	const auto & sourceHashes = cacheEntry->second.m_attrHashes;
+	for (const auto & attr : source.pluginAttrs) {
+		const auto filterIter = filterHash.m_attrHashes.find(attr.first);
+		if (filterIter == filterHash.m_attrHashes.end()) {
+			continue;
+		}
+		const auto sourceIter = sourceHashes.find(attr.first);
+		if (sourceIter == sourceHashes.end() || sourceIter->second != filterIter->second) {
+			result.pluginAttrs.insert(attr);
+		}
+	}
+
+	return result;
+}
@@ -24,7 +24,10 @@
 
 #include "utils/cgr_hash.h"
 
-#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include <boost/thread/shared_mutex.hpp>
 
 namespace VRayForBlender {
 /// Class that keeps track of what data is exported last, it keeps hashes for all plugin's properties
@@ -34,6 +37,21 @@ class PluginManager {
 	using HashAttr = VRayBaseTypes::AttrSimpleType<int>;
 
 public:
+	/// Number of independently locked parts of the cache
+	static const int ShardCount = 16;
+
+	/// Hash data kept for a single PluginDesc
+	struct PluginDescHash {
+		MHash m_allHash; ///< hash of all the properties
+		PluginDesc m_desc; ///< Either the full plugin desc or values are hashes of the real data
+		HashMap<std::string, MHash> m_attrHashes; ///< Hashes for the attributes in m_desc
+		float m_frame; ///< The frame which this plugin was cached
+
+		PluginDescHash()
+			: m_desc("", "")
+		{}
+	};
+
 	PluginManager(bool storeData)
 	    : m_storeData(storeData)
 	{}
@@ -47,6 +65,8 @@ public:
 	bool inCache(const PluginDesc &pluginDesc) const;
 	/// Check if the plugin desc passed to the method differs from the cached data
 	bool differs(const PluginDesc &pluginDesc) const;
+	/// Same as differs(pluginDesc) but with hash already calculated with makeHash
+	bool differs(const PluginDesc &pluginDesc, const PluginDescHash &descHash) const;
 	/// Check if the plugin desc passed to the method has differen plugin ID that the cached one
 	bool differsId(const PluginDesc &pluginDesc) const;
 
@@ -57,7 +77,16 @@ public:
 
 	/// Get new PluginDesc containing only the properties that are different in the cache or are missing
 	PluginDesc differences(const PluginDesc &pluginDesc) const;
+	/// Same as differences(pluginDesc) but with hash already calculated with makeHash
+	PluginDesc differences(const PluginDesc &pluginDesc, const PluginDescHash &descHash) const;
 
+	/// Check if the cached plugin @name has the same attribute values as @pluginDesc, only valid when storing data
+	/// @descHash - hash of @pluginDesc, the values are compared only if it matches the cached hash
+	bool sameAsCached(const std::string &name, const PluginDesc &pluginDesc, const PluginDescHash &descHash) const;
+
+	/// Calculate the hash of a given PluginDesc
+	/// Does not lock the cache, so it can run in parallel for many plugins
+	PluginDescHash makeHash(const PluginDesc &pluginDesc) const;
 
 	/// Wrapper over reference to plugin description and a frame, use this to avoid 2 cache lookups for frame and desc
 	struct FramePluginDesc {
@@ -66,21 +95,13 @@ public:
 	};
 
 	/// Get PluginDesc for a given name, it must exist in the cache
-	FramePluginDesc fromCache(const std::string &name) {
-		auto iter = m_cache.find(name);
-		const bool foundItem = iter != m_cache.end();
-		VFB_Assert(foundItem && "PluginManager::fromCache() called with NON cache plugin name!");
-		VFB_Assert(m_storeData && "PluginManager::fromCache called when m_storeData == false");
-		if (foundItem) {
-			return { iter->second.m_desc, iter->second.m_frame };
-		} else {
-			auto & item = m_cache[name];
-			return { item.m_desc, item.m_frame };
-		}
-	}
+	/// The reference stays valid while the caller holds the export lock of @name, see PluginExporter::getNameLock
+	FramePluginDesc fromCache(const std::string &name);
 
 	/// Update the cache with the given PluginDesc
 	void updateCache(const PluginDesc &desc, float frame);
+	/// Same as updateCache(desc, frame) but with hash already calculated with makeHash
+	void updateCache(const PluginDesc &desc, PluginDescHash descHash, float frame);
 	/// Remove data from the cache for a plugin
 	void remove(const PluginDesc &pluginDesc);
 	/// Remove data from the cache for a plugin
@@ -92,32 +113,55 @@ public:
 	/// @return - new plugin desc, with attributes from source that have different value in filter
 	static PluginDesc diffWithPlugin(const PluginDesc &source, const PluginDesc &filter);
 
+	/// Same as diffWithPlugin but compares the cached hashes of @source with @filterHash instead of hashing both
+	/// @source must be the cached desc of the plugin
+	PluginDesc diffCachedWithHash(const PluginDesc &source, const PluginDescHash &filterHash) const;
+
 	/// Clear everything from the cache
 	void clear();
+
+	/// Log lock statistics of the cache since the last call and reset them
+	/// @context - text describing the logged period
+	void logLockStats(const char *context) const;
 private:
-	/// Hash data kept for a single PluginDesc
-	struct PluginDescHash {
-		MHash m_allHash; ///< hash of all the properties
-		PluginDesc m_desc; ///< Either the full plugin desc or values are hashes of the real data
-		HashMap<std::string, MHash> m_attrHashes; ///< Hashes for the attributes in m_desc
-		float m_frame; ///< The frame which this plugin was cached
+	/// Counters for the accesses to one shard, updated without ordering since they are only for reporting
+	struct LockStats {
+		mutable std::atomic<uint64_t> m_reads; ///< Number of shared locks taken
+		mutable std::atomic<uint64_t> m_writes; ///< Number of exclusive locks taken
+		mutable std::atomic<uint64_t> m_contended; ///< Number of locks that had to wait
+		mutable std::atomic<uint64_t> m_waitNs; ///< Total time spent waiting in nanoseconds
+
+		LockStats(): m_reads(0), m_writes(0), m_contended(0), m_waitNs(0) {}
+	};
 
-		PluginDescHash()
-			: m_desc("", "")
-		{}
+	/// Part of the cache with it's own lock
+	struct Shard {
+		HashMap<std::string, PluginDescHash> m_cache; ///< map a plugin name to it's hash
+		mutable boost::shared_mutex m_lock; ///< lock protecting @m_cache, shared for lookups
+		LockStats m_stats; ///< Lock counters for this shard
 	};
 
-	/// Calculate the hash of a given PluginDesc
-	PluginDescHash makeHash(const PluginDesc &pluginDesc) const;
+	typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+	typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+
+	/// Take shared lock on @shard, counting if it had to wait for a writer
+	static ReadLock lockRead(const Shard &shard);
+	/// Take exclusive lock on @shard, counting if it had to wait
+	static WriteLock lockWrite(const Shard &shard);
+
+	/// Get index of the shard that keeps plugin with name @name
+	static int getShardIndex(const std::string &name) {
+		return std::hash<std::string>()(name) % ShardCount;
+	}
 
 	/// Check the difference of a PluginDesc with the cached data
 	/// @pluginDesc - the plugin description we want to filter/check
+	/// @descHash - hash of @pluginDesc
 	/// @uildDiff - if true the second member of the returned pair will contain only the different parameters
 	///             else it will be empty PluginDesc with only name and ID set
-	std::pair<bool, PluginDesc> diffWithCache(const PluginDesc &pluginDesc, bool buildDiff) const;
+	std::pair<bool, PluginDesc> diffWithCache(const PluginDesc &pluginDesc, const PluginDescHash &descHash, bool buildDiff) const;
 
-	HashMap<std::string, PluginDescHash> m_cache; ///< map a plugin name to it's hash
-	mutable std::mutex m_cacheLock; ///< lock protecting @m_cache
+	Shard m_shards[ShardCount]; ///< The cache split by plugin name
 	const bool m_storeData; ///< True if we are storing real data in PluginDescHash::m_desc or just hashes
 };
 
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vfb_plugin_update_queue.h"
+#include "vfb_export_profiler.h"
+
+using namespace VRayForBlender;
+
+
+void PluginUpdateQueue::push(const std::string &plugin, const std::string &attr, const AttrValue &value)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_stats.queued;
+
+	AttrIndex &attrs = m_index[plugin];
+	auto attrIt = attrs.find(attr);
+	if (attrIt != attrs.end()) {
+		m_updates[attrIt->second].value = value;
+		++m_stats.coalesced;
+	} else {
+		attrs.emplace(attr, static_cast<int>(m_updates.size()));
+		m_updates.push_back({plugin, attr, value, true});
+	}
+}
+
+
+void PluginUpdateQueue::dropPlugin(const std::string &plugin)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto pluginIt = m_index.find(plugin);
+	if (pluginIt == m_index.end()) {
+		return;
+	}
+
+	for (const auto &attrIt : pluginIt->second) {
+		Update &update = m_updates[attrIt.second];
+		update.valid = false;
+		// release list data now, the slot is freed on flush
+		update.value = AttrValue();
+		++m_stats.dropped;
+	}
+	m_index.erase(pluginIt);
+}
+
+
+int PluginUpdateQueue::flush(const SendCb &send)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int sent = 0;
+	for (const Update &update : m_updates) {
+		if (update.valid) {
+			send(update.plugin, update.attr, update.value);
+			m_stats.bytes += update.plugin.size() + update.attr.size() + ExportProfiler::getValueSize(update.value);
+			++sent;
+		}
+	}
+
+	m_updates.clear();
+	m_index.clear();
+
+	m_stats.sent += sent;
+	if (sent) {
+		++m_stats.flushes;
+	}
+	return sent;
+}
+
+
+bool PluginUpdateQueue::empty() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_updates.empty();
+}
+
+
+PluginUpdateQueue::Stats PluginUpdateQueue::getStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+
+void PluginUpdateQueue::resetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats = Stats();
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VRAY_FOR_BLENDER_PLUGIN_UPDATE_QUEUE_H
+#define VRAY_FOR_BLENDER_PLUGIN_UPDATE_QUEUE_H
+
+#include "vfb_typedefs.h"
+#include "vfb_plugin_attrs.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VRayForBlender {
+
+/// Collects plugin property updates until they are flushed, keeping only the last value set for each property
+/// Updates are flushed in the order their property was first set, so the sender decides when the
+/// order relative to other messages matters (commits, removes, frame changes)
+class PluginUpdateQueue {
+public:
+	struct Stats {
+		uint64_t queued    = 0; ///< Number of push() calls
+		uint64_t coalesced = 0; ///< Updates dropped because a newer value for the property was pushed
+		uint64_t dropped   = 0; ///< Updates dropped because their plugin was removed
+		uint64_t sent      = 0; ///< Updates passed to the send callback
+		uint64_t bytes     = 0; ///< Size of the sent names and list data
+		uint64_t flushes   = 0; ///< Number of flushes that sent at least one update
+	};
+
+	typedef std::function<void(const std::string &plugin, const std::string &attr, const AttrValue &value)> SendCb;
+
+	/// Queue @value for @plugin's @attr replacing the previously queued value
+	void     push(const std::string &plugin, const std::string &attr, const AttrValue &value);
+
+	/// Drop the queued updates of @plugin
+	void     dropPlugin(const std::string &plugin);
+
+	/// Call @send for each queued update and clear the queue
+	/// @return - the number of sent updates
+	int      flush(const SendCb &send);
+
+	bool     empty() const;
+
+	Stats    getStats() const;
+	void     resetStats();
+
+private:
+	struct Update {
+		std::string plugin;
+		std::string attr;
+		AttrValue   value;
+		bool        valid; ///< False if the update was dropped
+	};
+
+	typedef HashMap<std::string, int> AttrIndex;
+
+	mutable std::mutex               m_mutex; ///< Protects all members, held while sending so flushes keep their order
+	std::vector<Update>              m_updates; ///< Queued updates in order of first set
+	HashMap<std::string, AttrIndex>  m_index; ///< Plugin name -> attribute name -> index in m_updates
+	Stats                            m_stats;
+};
+
+} // namespace VRayForBlender
+
+#endif // VRAY_FOR_BLENDER_PLUGIN_UPDATE_QUEUE_H
@@ -20,9 +20,8 @@
 #include "vfb_plugin_writer.h"
 #include "BLI_fileops.h"
 
-#include "Python.h"
-
 #include <algorithm>
+#include <boost/filesystem.hpp>
 
 using namespace VRayBaseTypes;
 
@@ -51,55 +50,162 @@ struct TraceTransformHex {
 	double v[3];
 };
 
-bool PluginWriter::WriteItem::isDone() const {
-	return m_ready.load(std::memory_order_acquire);
+namespace {
+/// Max number of blocks waiting to be written, before addBlock starts waiting for the file
+const int MaxQueuedBlocks = 4096;
+
+/// Buffers bigger than this are moved out of the thread local buffer instead of copied
+const size_t MaxReusedBufferSize = 1 << 20;
+
+void write_file_impl(FILE * file, const char * data, int len = -1)
+{
+	const int writeLen = len == -1 ? strlen(data) : len;
+	if (fwrite(data, 1, writeLen, file) != writeLen) {
+		getLog().error("Failed to write to file!");
+	}
+}
+}
+
+const char PluginBinaryFile::Magic[8] = {'V', 'F', 'B', 'B', 'I', 'N', '\0', '\0'};
+
+PluginBinaryFile::PluginBinaryFile(const std::string &filePath)
+	: m_file(nullptr)
+	, m_size(0)
+{
+	m_name = boost::filesystem::path(filePath).filename().string();
+	m_file = BLI_fopen(filePath.c_str(), "wb");
+	if (!m_file) {
+		getLog().error("Failed to open binary file \"%s\"!", filePath.c_str());
+		return;
+	}
+
+	const int32_t version = Version;
+	if (fwrite(Magic, 1, sizeof(Magic), m_file) != sizeof(Magic) || fwrite(&version, 1, sizeof(version), m_file) != sizeof(version)) {
+		getLog().error("Failed to write binary file \"%s\"!", filePath.c_str());
+		fclose(m_file);
+		m_file = nullptr;
+		return;
+	}
+	m_size = sizeof(Magic) + sizeof(version);
+}
+
+PluginBinaryFile::~PluginBinaryFile()
+{
+	if (m_file) {
+		fclose(m_file);
+	}
+}
+
+int64_t PluginBinaryFile::write(const void *data, size_t size)
+{
+	static const char zeros[PayloadAlignment] = {0, };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_file) {
+		return -1;
+	}
+
+	const size_t padding = (PayloadAlignment - m_size % PayloadAlignment) % PayloadAlignment;
+	if (fwrite(zeros, 1, padding, m_file) != padding || fwrite(data, 1, size, m_file) != size) {
+		getLog().error("Failed to write %d bytes to binary file \"%s\"!", static_cast<int>(size), m_name.c_str());
+		// offsets after a failed write would be wrong
+		fclose(m_file);
+		m_file = nullptr;
+		return -1;
+	}
+
+	const int64_t offset = m_size + padding;
+	m_size = offset + size;
+	return offset;
 }
 
-const char * PluginWriter::WriteItem::getData(int &len) const {
-	if (m_isAsync) {
-		len = -1;
-		return m_asyncData;
+PluginBuffer::PluginBuffer(ExporterSettings::ExportFormat format)
+	: m_depth(1)
+	, m_animationFrame(INVALID_FRAME)
+	, m_format(format)
+	, m_zipLevel(1)
+	, m_binaryFile(nullptr)
+{}
+
+void PluginBuffer::reset(ExporterSettings::ExportFormat format, int zipLevel, PluginBinaryFile *binaryFile)
+{
+	m_data.clear();
+	m_depth = 1;
+	m_animationFrame = INVALID_FRAME;
+	m_format = format;
+	m_zipLevel = zipLevel;
+	m_binaryFile = binaryFile;
+}
+
+void PluginBuffer::takeData(std::string &dest)
+{
+	if (m_data.capacity() > MaxReusedBufferSize) {
+		// big meshes would otherwise keep their whole text allocated for each thread
+		dest.clear();
+		dest.swap(m_data);
+		std::string().swap(m_data);
 	} else {
-		len = m_data.length();
-		return m_data.c_str();
+		dest = m_data;
 	}
 }
 
-void PluginWriter::WriteItem::asyncDone(const char * data) {
-	VFB_Assert(m_isAsync && "Called asyncDone on sync WriteItem");
-	// first copy data into task
-	if (data) {
-		m_asyncData = data;
-		m_freeData = true;
+PluginBuffer &PluginBuffer::writeHexData(const u_int8_t *data, size_t size)
+{
+	if (m_format == ExporterSettings::ExportFormatZIP) {
+		if (!AppendStringZip(data, size, m_data, m_zipLevel)) {
+			getLog().error("Failed to compress %d bytes of list data!", static_cast<int>(size));
+		}
 	} else {
-		m_asyncData = "";
+		AppendStringHex(data, size, m_data);
 	}
-	// than mark as ready
-	// release-aquire order so readers will see m_asyncData changed if m_ready is true
-	m_ready.store(true, std::memory_order_release);
+	return *this;
 }
 
-PluginWriter::WriteItem::~WriteItem() {
-	if (m_freeData) {
-		delete[] m_asyncData;
+PluginBuffer &PluginBuffer::writeStr(const char *str)
+{
+	m_data.append(str);
+	return *this;
+}
+
+PluginBuffer &PluginBuffer::writeStr(const char *str, int len)
+{
+	m_data.append(str, len);
+	return *this;
+}
+
+PluginBuffer &PluginBuffer::writeBinaryData(const u_int8_t *data, size_t size)
+{
+	const int64_t offset = m_binaryFile ? m_binaryFile->write(data, size) : -1;
+	if (offset < 0) {
+		*this << "Hex(\"";
+		writeHexData(data, size);
+		return *this << "\")";
 	}
+
+	char buf[64];
+	const int len = snprintf(buf, sizeof(buf), "\", %lld, %lld)", static_cast<long long>(offset), static_cast<long long>(size));
+	*this << "Bin(\"" << m_binaryFile->getName();
+	return writeStr(buf, len);
 }
 
-PluginWriter::WriteItem::WriteItem(WriteItem && other): WriteItem() {
-	std::swap(m_data, other.m_data);
-	std::swap(m_asyncData, other.m_asyncData);
-	m_ready = other.m_ready.load();
-	other.m_ready = false;
-	std::swap(m_freeData, other.m_freeData);
-	std::swap(m_isAsync, other.m_isAsync);
+const char * PluginBuffer::indentation()
+{
+	switch (m_depth) {
+	case 0: return "";
+	case 1: return VRSCENE_INDENT;
+	case 2: return VRSCENE_INDENT VRSCENE_INDENT;
+	case 3: return VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT;
+	case 4: return VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT;
+	default: return "";
+	}
 }
 
 PluginWriter::PluginWriter(ThreadManager::Ptr tm, file_t *file, ExporterSettings::ExportFormat format)
 	: m_threadManager(tm)
-    , m_depth(1)
-    , m_animationFrame(INVALID_FRAME)
+    , m_pendingCost(0)
     , m_file(file)
     , m_format(format)
+    , m_zipLevel(1)
 {
 	if (!file) {
 		getLog().error("Plugin Writer create with invalid file pointer!");
@@ -108,7 +214,10 @@ PluginWriter::PluginWriter(ThreadManager::Ptr tm, file_t *file, ExporterSettings
 
 PluginWriter::~PluginWriter()
 {
-	fclose(m_file);
+	if (good()) {
+		blockFlushAll();
+		fclose(m_file);
+	}
 }
 
 bool PluginWriter::good() const
@@ -116,142 +225,162 @@ bool PluginWriter::good() const
 	return m_file != nullptr;
 }
 
-#define FormatAndAdd(pp, ...)                                     \
-	char buf[2048];                                               \
-	sprintf(buf, __VA_ARGS__);                                    \
-	pp.writeStr(buf);                                             \
-	return pp;                                                    \
-
-
 PluginWriter &PluginWriter::writeStr(const char *str)
 {
-	if (good()) {
-		addTask(str);
+	if (!good() || !str || !*str) {
+		return *this;
+	}
+
+	processItems();
+	if (m_items.empty()) {
+		// nothing pending, write directly
+		write_file_impl(m_file, str);
+	} else {
+		m_items.emplace_back();
+		m_items.back().data = str;
+		m_items.back().ready.store(true, std::memory_order_release);
 	}
 	return *this;
 }
 
-namespace {
-void write_file_impl(PyObject * file, const char * data, int)
+void PluginWriter::addBlock(BlockTask task, ThreadManager::Cost cost)
 {
-	PyObject * result = PyObject_CallMethod(file, _C("write"), _C("s"), data);
-	if (!result || PyErr_Occurred()) {
-		PyErr_PrintEx(0);
-		PyErr_Clear();
+	if (!good()) {
 		return;
 	}
 
-	Py_DECREF(result);
-}
-
-void write_file_impl(FILE * file, const char * data, int len = -1)
-{
-	const int writeLen = len == -1 ? strlen(data) : len;
-	if (fwrite(data, 1, writeLen, file) != writeLen) {
-		getLog().error("Failed to write to file!");
+	processItems();
+	// bound the memory kept in serialized but not yet written blocks
+	while (m_items.size() >= MaxQueuedBlocks) {
+		waitFront();
+		processItems();
 	}
-}
+
+	// when adding and removing elements from deque at the ends no references are invalidated
+	m_items.emplace_back();
+	WriteItem & item = m_items.back();
+	item.cost = cost;
+	m_pendingCost += cost;
+	const ExporterSettings::ExportFormat format = m_format;
+	const int zipLevel = m_zipLevel;
+	PluginBinaryFile * binaryFile = format == ExporterSettings::ExportFormatBIN ? m_binaryFile.get() : nullptr;
+
+	m_threadManager->addTask([this, &item, task, format, zipLevel, binaryFile](int, const volatile bool &) {
+		// reuse the allocated memory for all blocks serialized on this thread
+		thread_local PluginBuffer buffer;
+		buffer.reset(format, zipLevel, binaryFile);
+		task(buffer);
+		buffer.takeData(item.data);
+		{
+			// lock so the writing thread can't miss the notify between checking the flag and waiting
+			std::lock_guard<std::mutex> lock(m_itemMutex);
+			item.ready.store(true, std::memory_order_release);
+		}
+		m_itemDoneVar.notify_all();
+	}, ThreadManager::Priority::LOW, cost);
+
+	processItems();
 }
 
-void PluginWriter::processItems(const char * val)
+void PluginWriter::processItems()
 {
 	// this function will not be called concurrently
 	// so it is safe to traverse m_items and expect not to change during execution
-
-	const int maxRep = m_items.size();
-	for (int c = 0; c < maxRep && m_items.front().isDone(); ++c) {
-		int len = 0;
-		const char * data = m_items.front().getData(len);
-		write_file_impl(m_file, data, len);
+	while (!m_items.empty() && m_items.front().ready.load(std::memory_order_acquire)) {
+		const std::string & data = m_items.front().data;
+		write_file_impl(m_file, data.c_str(), data.length());
+		m_pendingCost -= m_items.front().cost;
 		m_items.pop_front();
 	}
+}
 
-	if (val && *val) {
-		if (m_items.empty()) {
-			// no items left in que, just write current value
-			write_file_impl(m_file, val);
-		} else {
-			m_items.push_back(WriteItem(val));
-		}
+void PluginWriter::waitFront()
+{
+	if (m_items.empty()) {
+		return;
 	}
+	const WriteItem & item = m_items.front();
+	std::unique_lock<std::mutex> lock(m_itemMutex);
+	m_itemDoneVar.wait(lock, [&item] { return item.ready.load(std::memory_order_acquire); });
 }
 
-
 void PluginWriter::blockFlushAll()
 {
 	SCOPED_TRACE("PluginWriter::blockFlushAll()");
-	for (int c = 0; c < m_items.size(); ++c) {
-		auto & item = m_items[c];
-		// lazy wait for item
-		while (!item.isDone()) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
-		}
-		int len = 0;
-		const char * data = item.getData(len);
-		write_file_impl(m_file, data, len);
+	if (!good()) {
+		return;
+	}
+	while (!m_items.empty()) {
+		waitFront();
+		processItems();
 	}
 	fflush(m_file);
-	m_items.clear();
 }
 
-const char * PluginWriter::indentation()
+void PluginWriter::blockFlushTo(ThreadManager::Cost maxPendingCost)
 {
-	switch (m_depth) {
-	case 0: return "";
-	case 1: return VRSCENE_INDENT;
-	case 2: return VRSCENE_INDENT VRSCENE_INDENT;
-	case 3: return VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT;
-	case 4: return VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT VRSCENE_INDENT;
-	default: return "";
+	if (!good()) {
+		return;
+	}
+	processItems();
+	while (!m_items.empty() && m_pendingCost > maxPendingCost) {
+		waitFront();
+		processItems();
 	}
 }
 
-PluginWriter &operator<<(PluginWriter &pp, int val)
+#define FormatAndAdd(pp, ...)                                     \
+	char buf[256];                                                \
+	const int len = snprintf(buf, sizeof(buf), __VA_ARGS__);      \
+	pp.writeStr(buf, std::min<int>(len, sizeof(buf) - 1));        \
+	return pp;                                                    \
+
+PluginBuffer &operator<<(PluginBuffer &pp, int val)
 {
 	FormatAndAdd(pp, "%d", val);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, float val)
+PluginBuffer &operator<<(PluginBuffer &pp, float val)
 {
 	FormatAndAdd(pp, "%.4f", val);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const char *val)
+PluginBuffer &operator<<(PluginBuffer &pp, const char *val)
 {
 	return *val ? pp.writeStr(val) : pp;
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const std::string &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const std::string &val)
 {
-	return !val.empty() ? pp.writeStr(val.c_str()) : pp;
+	return !val.empty() ? pp.writeStr(val.c_str(), val.length()) : pp;
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrColor &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrColor &val)
 {
 	FormatAndAdd(pp, "Color(%g,%g,%g)", val.r, val.g, val.b);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrAColor &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrAColor &val)
 {
 	FormatAndAdd(pp, "AColor(%g,%g,%g,%g)", val.color.r, val.color.g, val.color.b, val.alpha);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrVector &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrVector &val)
 {
 	FormatAndAdd(pp, "Vector(%g,%g,%g)", val.x, val.y, val.z);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrVector2 &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrVector2 &val)
 {
 	FormatAndAdd(pp, "Vector(%g,%g,0)", val.x, val.y);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrMatrix &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrMatrix &val)
 {
 	return pp << "Matrix(" << val.v0 << "," << val.v1 << "," << val.v2 << ")";
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrTransform &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrTransform &val)
 {
 	if (pp.format() == ExporterSettings::ExportFormatASCII) {
 		pp << "Transform(" << val.m << "," << val.offs << ")";
@@ -268,7 +397,7 @@ PluginWriter &operator<<(PluginWriter &pp, const AttrTransform &val)
 	return pp;
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrPlugin &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrPlugin &val)
 {
 	pp << StripString(val.plugin);
 	if (!val.output.empty()) {
@@ -277,7 +406,7 @@ PluginWriter &operator<<(PluginWriter &pp, const AttrPlugin &val)
 	return pp;
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrMapChannels &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrMapChannels &val)
 {
 	pp << "List(\n";
 
@@ -298,7 +427,7 @@ PluginWriter &operator<<(PluginWriter &pp, const AttrMapChannels &val)
 	return pp << pp.indentation() << ")";
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const AttrInstancer &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const AttrInstancer &val)
 {
 	pp << "List(" << val.frameNumber;
 
@@ -314,12 +443,12 @@ PluginWriter &operator<<(PluginWriter &pp, const AttrInstancer &val)
 	return pp << "\n" << pp.indentation() << ")";
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrListValue &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrListValue &val)
 {
 	return printList(pp, val, "", val.getCount() > 10 ? 2 : 0);
 }
 
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrValue &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrValue &val)
 {
 	switch (val.type) {
 	case ValueTypeInt: return pp << val.as<AttrSimpleType<int>>();
@@ -348,7 +477,7 @@ PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrValue &val)
 }
 
 template <>
-PluginWriter &printList(PluginWriter &pp, const VRayBaseTypes::AttrList<std::string> &val, const char *listName, int itemsPerLine)
+PluginBuffer &printList(PluginBuffer &pp, const VRayBaseTypes::AttrList<std::string> &val, const char *listName, int itemsPerLine)
 {
 	pp << "List" << listName;
 
@@ -379,31 +508,31 @@ PluginWriter &printList(PluginWriter &pp, const VRayBaseTypes::AttrList<std::str
 
 
 template <> inline
-PluginWriter &operator<<(PluginWriter &pp, const KVPair<std::string> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const KVPair<std::string> &val)
 {
 	return pp << pp.indent() << val.first << "=\"" << val.second << "\";\n" << pp.unindent();
 }
 
 template <> inline
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrSimpleType<std::string> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrSimpleType<std::string> &val)
 {
 	return pp << "\"" << val.value << "\"";
 }
 
 template <> inline
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<float> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<float> &val)
 {
 	return printList(pp, val, "Float");
 }
 
 template <> inline
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<int> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<int> &val)
 {
 	return printList(pp, val, "Int");
 }
 
 template <> inline
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<VRayBaseTypes::AttrVector> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<VRayBaseTypes::AttrVector> &val)
 {
 	return printList(pp, val, "Vector", 1);
 }
@@ -25,6 +25,8 @@
 #include <atomic>
 #include <set>
 #include <deque>
+#include <functional>
+#include <mutex>
 
 #include "vfb_plugin_attrs.h"
 #include "vfb_export_settings.h"
@@ -37,23 +39,126 @@ namespace VRayForBlender {
 
 #define VRSCENE_INDENT "\t"
 
+/// Binary side-car file for the big list payloads of a .vrscene file
+/// Payloads are written raw at page aligned offsets, so a loader can mmap them without any parsing.
+/// The file starts with PluginBinaryFile::Magic and a format version; the .vrscene references each
+/// payload as ListXBin("<side-car file name>", <offset>, <size in bytes>).
+class PluginBinaryFile {
+public:
+	static const char     Magic[8]; ///< File signature at offset 0
+	static const int      Version = 1; ///< Format version after the signature
+	static const int      PayloadAlignment = 4096; ///< Alignment of each payload in the file
+	static const size_t   MinPayloadSize = 16 * 1024; ///< Smaller lists are written inline in the .vrscene
+
+	/// Create the file at @filePath and write the header
+	explicit PluginBinaryFile(const std::string &filePath);
+	~PluginBinaryFile();
+
+	bool good() const { return m_file != nullptr; }
+
+	/// Get the file name used to reference it from the .vrscene
+	const std::string & getName() const { return m_name; }
+
+	/// Append payload, safe to call from many threads
+	/// @return offset of the payload in the file, or -1 on error
+	int64_t write(const void *data, size_t size);
+private:
+	std::mutex   m_mutex; ///< Protects writes and m_size
+	FILE        *m_file; ///< The side-car file
+	int64_t      m_size; ///< Number of bytes written so far
+	std::string  m_name; ///< File name without directory
+
+	VFB_DISABLE_COPY(PluginBinaryFile);
+};
+
+/// Growable text buffer a single plugin block is serialized into
+/// Used on worker threads, so it must not touch any state shared with other buffers
+class PluginBuffer {
+public:
+	explicit PluginBuffer(ExporterSettings::ExportFormat format = ExporterSettings::ExportFormatHEX);
+
+	/// Append null terminated string
+	PluginBuffer &writeStr(const char *str);
+	/// Append @len bytes from @str
+	PluginBuffer &writeStr(const char *str, int len);
+
+	/// Append raw list data as hex, or zipped hex for ZIP format
+	/// Zipped data is compressed and encoded in bounded blocks directly at the end of the buffer
+	PluginBuffer &writeHexData(const u_int8_t *data, size_t size);
+
+	/// Check if list data of @size bytes should be written with writeBinaryData
+	bool useBinaryData(size_t size) const { return m_binaryFile && size >= PluginBinaryFile::MinPayloadSize; }
+
+	/// Write raw list data in the binary side-car file and append the reference to it
+	/// Falls back to writing the data inline if writing the side-car fails
+	PluginBuffer &writeBinaryData(const u_int8_t *data, size_t size);
+
+	void setFormat(ExporterSettings::ExportFormat fm) { m_format = fm; }
+	ExporterSettings::ExportFormat format() const { return m_format; }
+
+	void setZipLevel(int level) { m_zipLevel = level; }
+	int zipLevel() const { return m_zipLevel; }
+
+	void setAnimationFrame(float frame) { m_animationFrame = frame; }
+	float getAnimationFrame() const { return m_animationFrame; }
+
+	const char * indent() { ++m_depth; return indentation(); }
+	const char * unindent() { --m_depth; return ""; }
+
+	const char * indentation();
+
+	/// Get the serialized data
+	const std::string & getData() const { return m_data; }
+
+	/// Move the data to @dest, small buffers are copied instead so their memory can be reused
+	void takeData(std::string &dest);
+
+	/// Clear the data and state but keep the allocated memory so the buffer can be reused
+	void reset(ExporterSettings::ExportFormat format, int zipLevel, PluginBinaryFile *binaryFile);
+private:
+	std::string                     m_data; ///< The serialized text
+	int                             m_depth; ///< Current indentation depth
+	float                           m_animationFrame; ///< The current animation frame
+	ExporterSettings::ExportFormat  m_format; ///< The file format (ASCII, HEX, ZIP)
+	int                             m_zipLevel; ///< Compression level used for ZIP format
+	PluginBinaryFile               *m_binaryFile; ///< Side-car file for big lists, null if not used
+
+	VFB_DISABLE_COPY(PluginBuffer);
+};
+
+/// Writes plugin blocks to a file
+/// Each block is serialized in it's own PluginBuffer on the thread manager's workers, and finished
+/// blocks are written to the file in the order they were added
 class PluginWriter {
 public:
 	typedef FILE file_t;
 
+	/// Function serializing one whole block in the buffer passed, called on some worker thread
+	typedef std::function<void(PluginBuffer &)> BlockTask;
+
 	PluginWriter(ThreadManager::Ptr tm, file_t *file, ExporterSettings::ExportFormat = ExporterSettings::ExportFormatHEX);
 	~PluginWriter();
 
+	/// Add already formatted string, it is written after all previously added blocks
 	PluginWriter &writeStr(const char *str);
 
+	/// Add block to be serialized asynchronously
+	/// @task - function which will fill the block's buffer
+	/// @cost - cost hint for the thread manager, bigger plugins should have bigger cost
+	void addBlock(BlockTask task, ThreadManager::Cost cost = 0);
+
 	void setFormat(ExporterSettings::ExportFormat fm) { m_format = fm; }
 	ExporterSettings::ExportFormat format() const { return m_format; }
 
+	void setZipLevel(int level) { m_zipLevel = level; }
+	int zipLevel() const { return m_zipLevel; }
+
+	/// Set side-car file for big list payloads, used only in BIN format
+	void setBinaryFile(std::shared_ptr<PluginBinaryFile> file) { m_binaryFile = file; }
+
 	bool good() const;
 
 	file_t *getFile() { return m_file; }
-	void setAnimationFrame(float frame) { m_animationFrame = frame; }
-	float getAnimationFrame() const { return m_animationFrame; }
 
 	bool operator==(const PluginWriter &other) const
 	{
@@ -65,132 +170,70 @@ public:
 		return !(*this == other);
 	}
 
-	const char * indent() { ++m_depth; return indentation(); }
-	const char * unindent() { --m_depth; return ""; }
-
-	const char * indentation();
-
-	void addTask(const char * data) {
-		processItems(data);
-	}
-
-	void addTask(const std::string & data) {
-		processItems(data.c_str());
-	}
-
-	/// Add task to the queue
-	template <typename T>
-	void addTask(const T &task) {
-		// when adding and removing elements from deque no references are invalidated
-
-		m_items.emplace_back();
-		auto & item = m_items.back();
-
-		// Array's data is actually shared_ptr so copy it inside to preserve the data
-		m_threadManager->addTask([&item, task, this](int, const volatile bool &) {
-			char * zipData = GetStringZip(reinterpret_cast<const u_int8_t *>(*task), task.getBytesCount());
-			item.asyncDone(zipData);
-		}, ThreadManager::Priority::LOW);
-
-		processItems();
-	}
-
 	/// Block until all items are done and wirtten to file
 	void blockFlushAll();
+
+	/// Block until the cost of the blocks not yet written is at most @maxPendingCost
+	/// Blocks are written in order, so this waits for the oldest ones
+	void blockFlushTo(ThreadManager::Cost maxPendingCost);
+
+	/// Get the sum of the cost hints of the blocks not yet written to the file
+	ThreadManager::Cost getPendingCost() const { return m_pendingCost; }
 private:
-	class WriteItem {
-	public:
-		/// Check if this write item is done (may be zipping currently)
-		bool isDone() const;
-
-		/// Get the data of this item
-		const char * getData(int &len) const;
-
-		/// Mark this item as done and store the pointer provided
-		void asyncDone(const char * data);
-
-		/// Release any data set in asycnDone
-		~WriteItem();
-
-		WriteItem(WriteItem && other);
-		WriteItem(const WriteItem &) = delete;
-		WriteItem & operator=(const WriteItem &) = delete;
-
-		/// Create item that is async task, which will be completed in some point in future
-		WriteItem()
-			: m_data("")
-			, m_asyncData(nullptr)
-			, m_ready(false)
-			, m_freeData(false)
-			, m_isAsync(true) {}
-
-		/// Create item that is done and has some value
-		explicit WriteItem(const std::string & val)
-			: m_data(val)
-			, m_asyncData(nullptr)
-			, m_ready(true)
-			, m_freeData(false)
-			, m_isAsync(false) {}
-
-		/// Create item that is done and has some value
-		explicit WriteItem(const char * val)
-			: m_data(val ? val : "")
-			, m_asyncData(nullptr)
-			, m_ready(true)
-			, m_freeData(false)
-			, m_isAsync(false) {}
-
-	private:
-		std::string        m_data; ///< Data if this item is created 'done'
-		const char        *m_asyncData; ///< Data if this item is asyncly zipped
-		std::atomic<bool>  m_ready; ///< Flag to check if this item is ready
-		bool               m_freeData; ///< True if data needs to be freed
-		bool               m_isAsync; ///< True if this item is async
+	/// One block of the output, written only after all blocks before it are written
+	struct WriteItem {
+		std::string         data; ///< The serialized text
+		std::atomic<bool>   ready; ///< Flag to check if data is filled
+		ThreadManager::Cost cost; ///< The cost hint passed to addBlock
+
+		WriteItem(): ready(false), cost(0) {}
 	};
 
-	/// Process any pending items
-	/// 1. write all completed items to file
-	/// 2. write val if queue is empty or add it to the queue
-	void processItems(const char * val = nullptr);
+	/// Write all completed items from the front of the queue to the file
+	void processItems();
+
+	/// Block until the first item in the queue is done
+	void waitFront();
 
 	std::mutex                      m_itemMutex; ///< only used to syncronize waiting for items
-	std::condition_variable         m_itemDoneVar; ///< used to block on blockFlushAll
+	std::condition_variable         m_itemDoneVar; ///< signaled each time some item is done
 	std::deque<WriteItem>           m_items; ///< Item queue for all items to be writen to files
+	ThreadManager::Cost             m_pendingCost; ///< Sum of the cost of all items in m_items
 	ThreadManager::Ptr              m_threadManager; ///< Thread manager for async items
-	int                             m_depth; ///< Current indentation depth
-	float                           m_animationFrame; ///< The current animation frame
 	file_t                         *m_file; ///< The file object coming from python api
 	ExporterSettings::ExportFormat  m_format; ///< The file format (ASCII, HEX, ZIP)
+	int                             m_zipLevel; ///< Compression level used for ZIP format
+	std::shared_ptr<PluginBinaryFile> m_binaryFile; ///< Side-car file for big lists, can be null
 
 private:
 	PluginWriter(const PluginWriter&) = delete;
 	PluginWriter &operator=(const PluginWriter&) = delete;
 };
 
-PluginWriter &operator<<(PluginWriter &pp, char val); /// Intentonally not implemeted - call the const char * version
-PluginWriter &operator<<(PluginWriter &pp, int val);
-PluginWriter &operator<<(PluginWriter &pp, float val);
-PluginWriter &operator<<(PluginWriter &pp, const char *val);
-PluginWriter &operator<<(PluginWriter &pp, const std::string &val);
-
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrColor &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrAColor &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrVector &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrVector2 &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrMatrix &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrTransform &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrPlugin &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrMapChannels &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrInstancer &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrListValue &val);
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrValue &val);
+PluginBuffer &operator<<(PluginBuffer &pp, char val); /// Intentonally not implemeted - call the const char * version
+PluginBuffer &operator<<(PluginBuffer &pp, int val);
+PluginBuffer &operator<<(PluginBuffer &pp, float val);
+PluginBuffer &operator<<(PluginBuffer &pp, const char *val);
+PluginBuffer &operator<<(PluginBuffer &pp, const std::string &val);
+
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrColor &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrAColor &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrVector &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrVector2 &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrMatrix &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrTransform &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrPlugin &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrMapChannels &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrInstancer &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrListValue &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrValue &val);
 
 template <typename T>
 using KVPair = std::pair<std::string, T>;
 
 
 template <typename T>
-PluginWriter &operator<<(PluginWriter &pp, const KVPair<T> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const KVPair<T> &val)
 {
 	if (pp.getAnimationFrame() == INVALID_FRAME || val.second.type == VRayBaseTypes::ValueTypePlugin) {
 		return pp << pp.indent() << val.first << "=" << val.second << ";\n" << pp.unindent();
@@ -200,19 +243,19 @@ PluginWriter &operator<<(PluginWriter &pp, const KVPair<T> &val)
 }
 
 template <>
-PluginWriter &operator<<(PluginWriter &pp, const KVPair<std::string> &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const KVPair<std::string> &val);
 
 template <typename T>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrSimpleType<T> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrSimpleType<T> &val)
 {
 	return pp << val.value;
 }
 
 template <>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrSimpleType<std::string> &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrSimpleType<std::string> &val);
 
 template <typename T>
-PluginWriter &printList(PluginWriter &pp, const VRayBaseTypes::AttrList<T> &val, const char *listName, int itemsPerLine = 0)
+PluginBuffer &printList(PluginBuffer &pp, const VRayBaseTypes::AttrList<T> &val, const char *listName, int itemsPerLine = 0)
 {
 	pp << "List" << listName;
 
@@ -240,36 +283,34 @@ PluginWriter &printList(PluginWriter &pp, const VRayBaseTypes::AttrList<T> &val,
 			pp << "\n" << pp.indentation();
 		}
 		pp << ")";
-	} else if (pp.format() == ExporterSettings::ExportFormatZIP) {
+	} else if (pp.useBinaryData(val.getBytesCount())) {
+		pp.writeBinaryData(reinterpret_cast<const u_int8_t *>(*val), val.getBytesCount());
+	} else {
 		pp << "Hex(\"";
-		pp.addTask(val);
+		pp.writeHexData(reinterpret_cast<const u_int8_t *>(*val), val.getBytesCount());
 		pp << "\")";
-	} else {
-		char * zipData = GetHex(reinterpret_cast<const u_int8_t *>(*val), val.getBytesCount());
-		pp << "Hex(\"" << zipData << "\")";
-		delete[] zipData;
 	}
 
 	return pp;
 }
 
 template <>
-PluginWriter &printList(PluginWriter &pp, const VRayBaseTypes::AttrList<std::string> &val, const char *listName, int itemsPerLine);
+PluginBuffer &printList(PluginBuffer &pp, const VRayBaseTypes::AttrList<std::string> &val, const char *listName, int itemsPerLine);
 
 template <typename T>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<T> &val)
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<T> &val)
 {
 	return printList(pp, val, "", 1);
 }
 
 template <>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<float> &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<float> &val);
 
 template <>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<int> &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<int> &val);
 
 template <>
-PluginWriter &operator<<(PluginWriter &pp, const VRayBaseTypes::AttrList<VRayBaseTypes::AttrVector> &val);
+PluginBuffer &operator<<(PluginBuffer &pp, const VRayBaseTypes::AttrList<VRayBaseTypes::AttrVector> &val);
 
 } // VRayForBlender
 
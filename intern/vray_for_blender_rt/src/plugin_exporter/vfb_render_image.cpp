@@ -22,34 +22,201 @@
 #include <cstring>
 #include <algorithm>
 
+#include "BLI_task.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "jpeglib.h"
 #include <setjmp.h>
 
 using namespace VRayForBlender;
 
 namespace {
-	void resetAlpha(float * data, int w, int h, int channels) {
-		if (channels == 4) {
-			for (int c = 3; c < w * h * channels; c+=4) {
-				data[c] = 1.0f;
-			}
+
+/// Rows converted by one task of convertImage
+const int ConvertRowsPerTask = 16;
+
+/// Images with less pixels are converted on the calling thread
+const int ConvertMinParallelPixels = 1 << 18;
+
+inline float clampValue(float value, float max, float val)
+{
+	return value > max ? val : value;
+}
+
+#ifdef __SSE2__
+/// Replace lanes of @value bigger than @max with @val, only for lanes set in @laneMask
+inline __m128 clampLanes(__m128 value, __m128 max, __m128 val, __m128 laneMask)
+{
+	const __m128 over = _mm_and_ps(_mm_cmpgt_ps(value, max), laneMask);
+	return _mm_or_ps(_mm_and_ps(over, val), _mm_andnot_ps(over, value));
+}
+#endif
+
+/// Copy @count pixels with @channels channels applying @options, @dest may be equal to @source
+/// Clamping skips the alpha of 4 channel pixels
+void processPixels(float *dest, const float *source, int count, int channels, int options, float max, float val)
+{
+	const bool doClamp = options & ImageRegion::Options::CLAMP;
+	const bool doAlpha = (options & ImageRegion::Options::RESET_ALPHA) && channels == 4;
+
+	if (!doClamp && !doAlpha) {
+		if (dest != source) {
+			memcpy(dest, source, count * channels * sizeof(float));
 		}
+		return;
 	}
 
-	void clamp(float * data, int w, int h, int channels, float max, float val) {
-		const int pixelCount = w * h;
-		for (int p = 0; p < pixelCount; ++p) {
-			float *pixel = data + (p * channels);
-			switch (channels) {
-			case 4:
-			case 3: pixel[2] = pixel[2] > max ? val : pixel[2];
-			case 2: pixel[1] = pixel[1] > max ? val : pixel[1];
-			case 1: pixel[0] = pixel[0] > max ? val : pixel[0];
+	if (channels == 4) {
+		int p = 0;
+#ifdef __SSE2__
+		const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		const __m128 alphaOne = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+		const __m128 maxV = _mm_set1_ps(max);
+		const __m128 valV = _mm_set1_ps(val);
+
+		for (; p < count; ++p) {
+			__m128 pixel = _mm_loadu_ps(source + p * 4);
+			if (doClamp) {
+				pixel = clampLanes(pixel, maxV, valV, rgbMask);
+			}
+			if (doAlpha) {
+				pixel = _mm_or_ps(_mm_and_ps(pixel, rgbMask), alphaOne);
 			}
+			_mm_storeu_ps(dest + p * 4, pixel);
+		}
+#endif
+		for (; p < count; ++p) {
+			const float *from = source + p * 4;
+			float *to = dest + p * 4;
+			for (int c = 0; c < 3; ++c) {
+				to[c] = doClamp ? clampValue(from[c], max, val) : from[c];
+			}
+			to[3] = doAlpha ? 1.f : from[3];
+		}
+	} else {
+		// without alpha all values are clamped so pixels are just a flat array
+		const int size = count * channels;
+		int c = 0;
+#ifdef __SSE2__
+		const __m128 allMask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		const __m128 maxV = _mm_set1_ps(max);
+		const __m128 valV = _mm_set1_ps(val);
+
+		for (; c + 4 <= size; c += 4) {
+			_mm_storeu_ps(dest + c, clampLanes(_mm_loadu_ps(source + c), maxV, valV, allMask));
+		}
+#endif
+		for (; c < size; ++c) {
+			dest[c] = clampValue(source[c], max, val);
+		}
+	}
+}
+
+/// Copy @count RGBA pixels from @source to RGB pixels in @dest, clamping to 1 if requested
+void rgbaToRGB(float * __restrict dest, const float * __restrict source, int count, bool doClamp)
+{
+	int p = 0;
+#ifdef __SSE2__
+	const __m128 laneMask = _mm_castsi128_ps(_mm_set1_epi32(doClamp ? -1 : 0));
+	const __m128 one = _mm_set1_ps(1.f);
+
+	// each store writes one float past the pixel which is overwritten by the next one,
+	// so the last pixel is left for the scalar loop
+	for (; p + 1 < count; ++p) {
+		_mm_storeu_ps(dest + p * 3, clampLanes(_mm_loadu_ps(source + p * 4), one, one, laneMask));
+	}
+#endif
+	for (; p < count; ++p) {
+		for (int c = 0; c < 3; ++c) {
+			const float value = source[p * 4 + c];
+			dest[p * 3 + c] = doClamp ? clampValue(value, 1.f, 1.f) : value;
 		}
 	}
 }
 
+/// Copy the first channel of @count RGBA pixels from @source to @dest, clamping to 1 if requested
+void rgbaToBW(float * __restrict dest, const float * __restrict source, int count, bool doClamp)
+{
+	int p = 0;
+#ifdef __SSE2__
+	const __m128 laneMask = _mm_castsi128_ps(_mm_set1_epi32(doClamp ? -1 : 0));
+	const __m128 one = _mm_set1_ps(1.f);
+
+	for (; p + 4 <= count; p += 4) {
+		const float *from = source + p * 4;
+		// (p0.r, p1.r, p0.g, p1.g) and (p2.r, p3.r, p2.g, p3.g)
+		const __m128 low = _mm_unpacklo_ps(_mm_loadu_ps(from), _mm_loadu_ps(from + 4));
+		const __m128 high = _mm_unpacklo_ps(_mm_loadu_ps(from + 8), _mm_loadu_ps(from + 12));
+		_mm_storeu_ps(dest + p, clampLanes(_mm_movelh_ps(low, high), one, one, laneMask));
+	}
+#endif
+	for (; p < count; ++p) {
+		const float value = source[p * 4];
+		dest[p] = doClamp ? clampValue(value, 1.f, 1.f) : value;
+	}
+}
+
+struct ConvertImageTask {
+	float       *dest;
+	int          destChannels;
+	const float *source;
+	int          w;
+	int          h;
+	bool         flip;
+	int          options;
+};
+
+/// Convert rows [block * ConvertRowsPerTask, (block + 1) * ConvertRowsPerTask)
+void convertImageRows(void *__restrict userdata, const int block, const ParallelRangeTLS *__restrict)
+{
+	const ConvertImageTask &task = *reinterpret_cast<const ConvertImageTask*>(userdata);
+	const bool doClamp = task.options & ImageRegion::Options::CLAMP;
+
+	const int rowEnd = std::min(task.h, (block + 1) * ConvertRowsPerTask);
+	for (int row = block * ConvertRowsPerTask; row < rowEnd; ++row) {
+		const float *source = task.source + row * task.w * 4;
+		float *dest = task.dest + (task.flip ? task.h - row - 1 : row) * task.w * task.destChannels;
+
+		switch (task.destChannels) {
+		case 4:
+			processPixels(dest, source, task.w, 4, task.options, 1.f, 1.f);
+			break;
+		case 3:
+			rgbaToRGB(dest, source, task.w, doClamp);
+			break;
+		case 1:
+			rgbaToBW(dest, source, task.w, doClamp);
+			break;
+		}
+	}
+}
+
+}
+
+void VRayForBlender::convertImage(
+	float * __restrict dest, int destChannels, const float * __restrict source,
+	int w, int h, bool flip, ImageRegion::Options options)
+{
+	VFB_Assert((destChannels == 4 || destChannels == 3 || destChannels == 1) && "Unsupported destination channels count");
+
+	ConvertImageTask task;
+	task.dest = dest;
+	task.destChannels = destChannels;
+	task.source = source;
+	task.w = w;
+	task.h = h;
+	task.flip = flip;
+	task.options = options;
+
+	ParallelRangeSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = w * h >= ConvertMinParallelPixels;
+	BLI_task_parallel_range(0, (h + ConvertRowsPerTask - 1) / ConvertRowsPerTask, &task, convertImageRows, &settings);
+}
+
 void VRayForBlender::updateImageRegion(
 	void * __restrict dest, ImageSize destSize, ImageRegion destRegion,
 	const void * __restrict source, ImageSize sourceSize, ImageRegion sourceRegion, ImageRegion::Options options)
@@ -70,18 +237,11 @@ void VRayForBlender::updateImageRegion(
 
 	const int destEnd = destSize.h - destRegion.y - 1;
 
-	const int copyLineSize = destRegion.w * pixelSize;
 	for (int c = 0; c < destRegion.h; c++) {
 		float * destLine = reinterpret_cast<float*>(dest) + destLineSize * (destEnd - c) + destLeftPad;
 		const float * sourceLine = reinterpret_cast<const float*>(source) + sourceLineSize * (c + sourceRegion.y) + sourceLeftPad;
 
-		memcpy(destLine, sourceLine, copyLineSize * sizeof(float));
-		if (options & ImageRegion::Options::CLAMP) {
-			::clamp(destLine, destRegion.w, 1, pixelSize, 1.0f, 1.0f);
-		}
-		if (options & ImageRegion::Options::RESET_ALPHA) {
-			::resetAlpha(destLine, destRegion.w, 1, pixelSize);
-		}
+		processPixels(destLine, sourceLine, destRegion.w, pixelSize, options, 1.0f, 1.0f);
 	}
 }
 
@@ -124,7 +284,7 @@ RenderImage RenderImage::deepCopy(const RenderImage &source)
 
 RenderImage::~RenderImage()
 {
-	delete pixels;
+	delete[] pixels;
 	pixels = nullptr;
 }
 
@@ -139,23 +299,14 @@ void RenderImage::updateRegion(const float *source, ImageRegion destRegion)
 void RenderImage::flip()
 {
 	if (pixels && w && h) {
-		const int half_h = h / 2;
-
 		const int row_items = w * channels;
-		const int row_bytes = row_items * sizeof(float);
-
-		float *buf = new float[row_items];
 
-		for (int i = 0; i < half_h; ++i) {
+		for (int i = 0; i < h / 2; ++i) {
 			float *to_row   = pixels + (i       * row_items);
 			float *from_row = pixels + ((h-i-1) * row_items);
 
-			memcpy(buf,      to_row,   row_bytes);
-			memcpy(to_row,   from_row, row_bytes);
-			memcpy(from_row, buf,      row_bytes);
+			std::swap_ranges(to_row, to_row + row_items, from_row);
 		}
-
-		FreePtr(buf);
 	}
 }
 
@@ -163,7 +314,7 @@ void RenderImage::flip()
 void RenderImage::resetAlpha()
 {
 	if (pixels && w && h) {
-		::resetAlpha(pixels, w, h, channels);
+		processPixels(pixels, pixels, w * h, channels, ImageRegion::Options::RESET_ALPHA, 1.0f, 1.0f);
 	}
 }
 
@@ -171,7 +322,7 @@ void RenderImage::resetAlpha()
 void RenderImage::clamp(float max, float val)
 {
 	if (pixels && w && h) {
-		::clamp(pixels, w, h, channels, max, val);
+		processPixels(pixels, pixels, w * h, channels, ImageRegion::Options::CLAMP, max, val);
 	}
 }
 
@@ -201,6 +352,108 @@ void RenderImage::cropTo(int width, int height)
 	pixels = newImg;
 }
 
+RenderImageTiles RenderImageTiles::fromImage(const RenderImage &image, const std::vector<ImageRegion> &regions)
+{
+	RenderImageTiles tiles;
+	tiles.w = image.w;
+	tiles.h = image.h;
+	tiles.channels = image.channels;
+
+	if (!image.pixels) {
+		return tiles;
+	}
+
+	tiles.regions.reserve(regions.size());
+	for (const ImageRegion &region : regions) {
+		// regions come from the renderer so clip them just in case
+		const int x = std::max(0, region.x);
+		const int y = std::max(0, region.y);
+		const int w = std::min(image.w, region.x + region.w) - x;
+		const int h = std::min(image.h, region.y + region.h) - y;
+		if (w > 0 && h > 0) {
+			tiles.regions.push_back(ImageRegion(x, y, w, h));
+		}
+	}
+
+	tiles.pixels.resize(tiles.getPixelCount() * image.channels);
+
+	float *dest = tiles.pixels.data();
+	for (const ImageRegion &region : tiles.regions) {
+		const int rowSize = region.w * image.channels;
+		for (int row = 0; row < region.h; ++row) {
+			const float *source = image.pixels + ((region.y + row) * image.w + region.x) * image.channels;
+			memcpy(dest, source, rowSize * sizeof(float));
+			dest += rowSize;
+		}
+	}
+
+	return tiles;
+}
+
+void RenderImageTiles::copyTo(float *dest, ImageSize destSize) const
+{
+	VFB_Assert(destSize.channels == channels && "Tiles and destination must have same number of channels");
+
+	// same offsets as RenderImage::cropTo
+	const int leftOffset = std::max(0, (w - destSize.w) / 2);
+	const int topOffset = std::max(0, (h - destSize.h) / 2);
+
+	const float *source = pixels.data();
+	for (const ImageRegion &region : regions) {
+		const int rowSize = region.w * channels;
+
+		const int destX = region.x - leftOffset;
+		const int copyBegin = std::max(0, -destX);
+		const int copyEnd = std::min(region.w, destSize.w - destX);
+
+		for (int row = 0; row < region.h && copyBegin < copyEnd; ++row) {
+			const int destY = region.y + row - topOffset;
+			if (destY >= 0 && destY < destSize.h) {
+				memcpy(dest + (destY * destSize.w + destX + copyBegin) * channels,
+				       source + row * rowSize + copyBegin * channels,
+				       (copyEnd - copyBegin) * channels * sizeof(float));
+			}
+		}
+		source += region.h * rowSize;
+	}
+}
+
+int RenderImageTiles::getPixelCount() const
+{
+	int count = 0;
+	for (const ImageRegion &region : regions) {
+		count += region.w * region.h;
+	}
+	return count;
+}
+
+RenderImageBuffer::~RenderImageBuffer()
+{
+	delete[] m_pixels;
+}
+
+float * RenderImageBuffer::get(int size)
+{
+	if (size > m_size) {
+		delete[] m_pixels;
+		m_pixels = new float[size];
+		m_size = size;
+	}
+	return m_pixels;
+}
+
+void RenderImageBuffer::swap(RenderImage &image, int w, int h, int channels)
+{
+	const int imageSize = image.pixels ? image.w * image.h * image.channels : 0;
+
+	std::swap(image.pixels, m_pixels);
+	m_size = imageSize;
+
+	image.w = w;
+	image.h = h;
+	image.channels = channels;
+}
+
 namespace {
 
 struct JpegErrorManager {
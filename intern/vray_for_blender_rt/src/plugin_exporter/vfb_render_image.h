@@ -71,6 +71,18 @@ void updateImageRegion(
 );
 
 
+/// Convert a 4 channel image to @destChannels channels, rows are converted in parallel for big images
+/// @param dest - memory for w * h * destChannels floats, must not overlap @source
+/// @param destChannels - 4, 3 (alpha is dropped) or 1 (only the first channel is kept)
+/// @param source - w * h pixels with 4 channels
+/// @param flip - write the rows in reverse order
+/// @param options - CLAMP and RESET_ALPHA are applied while copying
+void convertImage(
+	float * __restrict dest, int destChannels, const float * __restrict source,
+	int w, int h, bool flip, ImageRegion::Options options = ImageRegion::Options::NONE
+);
+
+
 struct RenderImage {
 	RenderImage()
 	    : pixels(nullptr)
@@ -112,6 +124,62 @@ public:
 	float  updated;///< will hold % of updated area
 };
 
+/// Copies of the regions of a render image that changed since they were last taken
+struct RenderImageTiles {
+	RenderImageTiles()
+	    : w(0)
+	    , h(0)
+	    , channels(0)
+	{}
+
+	/// Copy @regions of @image
+	static RenderImageTiles fromImage(const RenderImage &image, const std::vector<ImageRegion> &regions);
+
+	operator bool () const {
+		return !regions.empty();
+	}
+
+	/// Write the tiles to an image with @destSize, @destSize.channels must match
+	/// If dest is smaller the image is cropped around its center like RenderImage::cropTo does
+	void copyTo(float *dest, ImageSize destSize) const;
+
+	/// Get the number of pixels in all regions
+	int getPixelCount() const;
+
+	int                      w; ///< width of the whole image
+	int                      h; ///< height of the whole image
+	int                      channels; ///< channels count
+	std::vector<ImageRegion> regions; ///< updated regions, in image pixel coordinates
+	std::vector<float>       pixels; ///< pixels of all regions one after another, row by row
+};
+
+
+/// Spare pixel buffer for a RenderImage that is replaced as a whole
+/// New data is written to the spare buffer without holding the image lock and then swapped
+/// with the image's pixels, so continuous updates reuse the same two allocations
+class RenderImageBuffer {
+public:
+	RenderImageBuffer()
+	    : m_pixels(nullptr)
+	    , m_size(0)
+	{}
+
+	RenderImageBuffer(const RenderImageBuffer &) = delete;
+	RenderImageBuffer & operator=(const RenderImageBuffer &) = delete;
+
+	~RenderImageBuffer();
+
+	/// Get memory for at least @size floats, contents are undefined
+	float * get(int size);
+
+	/// Make the buffer the pixels of @image with the given dimensions and keep the image's previous pixels as spare
+	void swap(RenderImage &image, int w, int h, int channels);
+
+private:
+	float *m_pixels; ///< the spare memory
+	int    m_size; ///< number of floats in m_pixels
+};
+
 float * jpegToPixelData(unsigned char * data, int size, int &channels);
 
 } // namespace VRayForBlender
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vfb_viewport_transport.h"
+#include "vfb_log.h"
+
+#include <algorithm>
+
+using namespace VRayForBlender;
+
+namespace {
+
+/// JPEG qualities tried before lowering the resolution
+const int JpegQualitySteps[] = {70, 50};
+
+/// Resolution scales tried after the lowest JPEG quality
+const float ResolutionSteps[] = {0.75f, 0.5f, 0.35f};
+
+/// Time without view changes after which the preferred format is restored
+const double IdleSeconds = 1.0;
+
+/// Weight of a new latency sample in the moving average
+const double LatencyWeight = 0.3;
+
+/// Use a cheaper format if the latency is above target * DegradeRatio for DegradeSamples samples
+const double DegradeRatio = 1.25;
+const int    DegradeSamples = 3;
+
+/// Use a better format if the latency is below target * ImproveRatio for ImproveSamples samples
+/// The gap to DegradeRatio prevents switching back and forth between two formats
+const double ImproveRatio = 0.5;
+const int    ImproveSamples = 6;
+
+double toSeconds(ViewportTransport::Clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+}
+
+
+ViewportTransport::ViewportTransport()
+    : m_targetSeconds(0.f)
+    , m_level(0)
+    , m_waitingImage(false)
+    , m_latency(0.0)
+    , m_samples(0)
+{
+	m_levels.push_back(Format());
+}
+
+
+void ViewportTransport::setPreferred(const Format &format, float targetSeconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_levels[0] == format && m_targetSeconds == targetSeconds) {
+		return;
+	}
+
+	m_levels.assign(1, format);
+	m_targetSeconds = targetSeconds;
+	buildLevels();
+	setLevel(0);
+}
+
+
+void ViewportTransport::buildLevels()
+{
+	Format format = m_levels[0];
+	format.scale = 1.f;
+
+	if (format.type != ImageType::JPG) {
+		format.type = ImageType::JPG;
+		m_levels.push_back(format);
+	}
+
+	for (int quality : JpegQualitySteps) {
+		if (quality < format.quality) {
+			format.quality = quality;
+			m_levels.push_back(format);
+		}
+	}
+
+	for (float scale : ResolutionSteps) {
+		format.scale = scale;
+		m_levels.push_back(format);
+	}
+}
+
+
+void ViewportTransport::setLevel(int level)
+{
+	m_level = std::max(0, std::min(level, static_cast<int>(m_levels.size()) - 1));
+	m_latency = 0.0;
+	m_samples = 0;
+	// an image for a change sent with the previous format does not measure the new one
+	m_waitingImage = false;
+}
+
+
+void ViewportTransport::restoreIfIdle(Clock::time_point now)
+{
+	if (m_level != 0 && toSeconds(now - m_lastChange) >= IdleSeconds) {
+		setLevel(0);
+	}
+}
+
+
+void ViewportTransport::viewChanged(Clock::time_point when)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	restoreIfIdle(when);
+	// while waiting keep the time of the first change, it is the latency the user sees
+	if (!m_waitingImage) {
+		m_waitingImage = true;
+		m_waitStart = when;
+	}
+	m_lastChange = when;
+}
+
+
+void ViewportTransport::imageReceived(Clock::time_point when)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_waitingImage || m_targetSeconds <= 0.f) {
+		return;
+	}
+	m_waitingImage = false;
+
+	const double latency = toSeconds(when - m_waitStart);
+	m_latency = m_samples ? m_latency + LatencyWeight * (latency - m_latency) : latency;
+	++m_samples;
+
+	const int lastLevel = static_cast<int>(m_levels.size()) - 1;
+	if (m_samples >= DegradeSamples && m_latency > m_targetSeconds * DegradeRatio && m_level < lastLevel) {
+		getLog().info("Viewport image latency %.0fms, switching to a cheaper image format", m_latency * 1000.0);
+		setLevel(m_level + 1);
+	} else if (m_samples >= ImproveSamples && m_latency < m_targetSeconds * ImproveRatio && m_level > 0) {
+		getLog().info("Viewport image latency %.0fms, switching to a better image format", m_latency * 1000.0);
+		setLevel(m_level - 1);
+	}
+}
+
+
+ViewportTransport::Format ViewportTransport::getFormat(Clock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	restoreIfIdle(now);
+	return m_levels[m_level];
+}
+
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VRAY_FOR_BLENDER_VIEWPORT_TRANSPORT_H
+#define VRAY_FOR_BLENDER_VIEWPORT_TRANSPORT_H
+
+#include "base_types.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace VRayForBlender {
+
+/// Chooses the format of the viewport images sent by the renderer so a view change
+/// is answered with a new image within a target time
+///
+/// Formats are ordered from the preferred (user's) one to the cheapest: the image type is switched to JPEG,
+/// then the JPEG quality and finally the resolution are lowered. The measured latency is the time
+/// between sending a view change and having the first image after it decoded.
+/// While the view is changing the learned format is used, once it is still for a while
+/// the preferred format is restored so the image converges at full quality, and the next
+/// changes start learning again from the preferred format.
+class ViewportTransport {
+public:
+	typedef std::chrono::steady_clock Clock;
+	using ImageType = VRayBaseTypes::AttrImage::ImageType;
+
+	struct Format {
+		Format()
+		    : type(ImageType::RGBA_REAL)
+		    , quality(100)
+		    , scale(1.f)
+		{}
+
+		Format(ImageType type, int quality, float scale)
+		    : type(type)
+		    , quality(quality)
+		    , scale(scale)
+		{}
+
+		bool operator==(const Format &other) const {
+			return type == other.type && quality == other.quality && scale == other.scale;
+		}
+
+		bool operator!=(const Format &other) const {
+			return !(*this == other);
+		}
+
+		ImageType type;
+		int       quality; ///< JPEG quality
+		float     scale; ///< Multiplier of the viewport render size
+	};
+
+	ViewportTransport();
+
+	/// Set the format used when the view is still and the target latency
+	/// Resets the learned format if any of them changed
+	void     setPreferred(const Format &format, float targetSeconds);
+
+	/// Called when a change of the view or the scene was sent to the renderer
+	/// Not to be called for resizes caused by a format change, they would keep the view from going idle
+	void     viewChanged(Clock::time_point when);
+
+	/// Called when an image of the viewport was received and decoded
+	void     imageReceived(Clock::time_point when);
+
+	/// Get the format the renderer should use at @now
+	/// Restores the preferred format if the view was not changed for a while
+	Format   getFormat(Clock::time_point now);
+
+private:
+	void     buildLevels();
+	void     setLevel(int level);
+	void     restoreIfIdle(Clock::time_point now);
+
+	mutable std::mutex  m_mutex;
+
+	std::vector<Format> m_levels; ///< Formats from the preferred to the cheapest
+	float               m_targetSeconds;
+	int                 m_level; ///< Index in m_levels used while the view is changing
+
+	Clock::time_point   m_lastChange; ///< Time of the last view change
+	Clock::time_point   m_waitStart; ///< Time of the first view change not answered with an image
+	bool                m_waitingImage; ///< True if no image was received since m_waitStart
+
+	double              m_latency; ///< Moving average of the latency for m_level
+	int                 m_samples; ///< Number of latency samples taken for m_level
+};
+
+} // namespace VRayForBlender
+
+#endif // VRAY_FOR_BLENDER_VIEWPORT_TRANSPORT_H
@@ -108,10 +108,14 @@ AttrValue DataExporter::exportVRayNodeTexVoxelData(BL::NodeTree &ntree, BL::Node
 
 						std::string pluginName    = GenPluginName(node, ntree, context);
 						int         interpolation = RNA_enum_get(&texVoxelData, "interpolation");
+						bool        sparse        = get<bool>(texVoxelData, "sparse", false);
+						float       threshold     = get<float>(texVoxelData, "sparse_threshold", 0.f);
+						bool        quantizeHalf  = get<bool>(texVoxelData, "quantize_half", false);
 
 						if (m_settings.export_fluids) {
 							TexVoxelData texVoxelData((Object*)domainOb.ptr.data);
 							texVoxelData.initName(pluginName);
+							texVoxelData.setSparse(sparse, threshold, quantizeHalf);
 							texVoxelData.init((SmokeModifierData*)smokeMod.ptr.data);
 							texVoxelData.setInterpolation(interpolation);
 
@@ -33,6 +33,10 @@
 
 using namespace VRayForBlender;
 
+#if USE_MT_EXPORTER
+boost::shared_mutex vfbExporterBlenderLock;
+#endif
+
 #ifdef WITH_OSL
 // OSL
 #include <OSL/oslconfig.h>
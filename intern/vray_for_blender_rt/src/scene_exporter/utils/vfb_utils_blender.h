@@ -36,7 +36,8 @@
 
 #if USE_MT_EXPORTER
 // This is global because multiple mt exporters could run at the same time
-static boost::shared_mutex vfbExporterBlenderLock;
+// Defined in vfb_utils_blender.cpp so all translation units share the same lock
+extern boost::shared_mutex vfbExporterBlenderLock;
 #define WRITE_LOCK_BLENDER_RAII boost::unique_lock<boost::shared_mutex> _raiiWriteLock(vfbExporterBlenderLock);
 #define READ_LOCK_BLENDER_RAII boost::shared_lock<boost::shared_mutex> _raiiReadLock(vfbExporterBlenderLock);
 #else
@@ -22,285 +22,122 @@
 #include "vfb_typedefs.h"
 #include "vfb_plugin_manager.h"
 
-#include "utils/cgr_hash.h"
+#include "utils/cgr_weld.h"
 
 #include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+#include "BLI_math.h"
+#include "BLI_task.h"
 
 #include <thread>
 
 using namespace VRayForBlender;
 
-struct ChanVertex
-{
-	ChanVertex()
-		: index(0)
+/// Values of one UV or vertex color layer for each triangle corner
+struct ChannelCorners {
+	ChannelCorners(const std::string &name, int numCorners)
+		: name(name)
+		, vertices(numCorners)
 	{}
 
-	template <int size>
-	ChanVertex(const BL::Array<float, size> &data)
-		: index(0)
-	{
-		float *dest = &v.x;
-		for (int c = 0; c < std::min(3, size); c++) {
-			dest[c] = data[c];
-		}
-	}
-
-	bool operator == (const ChanVertex &other) const {
-		return (v.x == other.v.x) && (v.y == other.v.y) && (v.z == other.v.z);
-	}
-
-	AttrVector   v;
-	mutable int  index;
+	std::string     name;
+	AttrListVector  vertices;
 };
 
-struct MapVertexHash {
-	std::size_t operator () (const ChanVertex &mv) const {
-		MHash hash;
-		MurmurHash3_x86_32(&mv.v, sizeof(AttrVector), 42, &hash);
-		return static_cast<std::size_t>(hash);
-	}
-};
+typedef std::vector<ChannelCorners> ChannelsCorners;
 
-typedef HashSet<ChanVertex, MapVertexHash>  ChanSet;
-typedef HashMap<std::string, ChanSet>       ChanMap;
+/// Min number of corners for welding the map channels in parallel
+const int ParallelWeldMinCorners = 1 << 18;
 
 
-struct MapChannelBase {
-	MapChannelBase(BL::Mesh mesh, int numFaces):
-	    mesh(mesh),
-	    num_faces(numFaces)
-	{
-		num_channels = mesh.tessface_uv_textures.length() +
-		               mesh.tessface_vertex_colors.length();
-	}
+/// Each corner gets its own channel vertex, corner data is used as is
+static void MapChannelRaw(ChannelCorners &corners, AttrMapChannels::AttrMapChannel &map_channel)
+{
+	const int numCorners = corners.vertices.getCount();
 
-	virtual void init()=0;
-	virtual void init_attributes(AttrListString &map_channels_names, AttrMapChannels &map_channels)=0;
-	virtual bool needProcessFaces() const { return false; }
-	virtual int  get_map_face_vertex_index(const std::string&, const ChanVertex&) { return -1; }
+	map_channel.vertices = corners.vertices;
+	map_channel.faces.resize(numCorners);
 
-	int numChannels() const {
-		return num_channels;
+	int *faces = *map_channel.faces;
+	for (int i = 0; i < numCorners; ++i) {
+		faces[i] = i;
 	}
-
-protected:
-	BL::Mesh  mesh;
-	int       num_channels;
-	int       num_faces;
-
-};
+}
 
 
-struct MapChannelRaw:
-        MapChannelBase
+/// Corners with equal values share one channel vertex
+static void MapChannelMerge(ChannelCorners &corners, AttrMapChannels::AttrMapChannel &map_channel)
 {
-	MapChannelRaw(BL::Mesh mesh, int numFaces):
-	    MapChannelBase(mesh, numFaces)
-	{}
-
-	virtual void init() override {}
-	virtual void init_attributes(AttrListString &map_channels_names, AttrMapChannels &map_channels) override {
-
-		if (num_channels) {
-			// Init storage
-			//
-			BL::Mesh::tessface_uv_textures_iterator uvIt;
-			for(mesh.tessface_uv_textures.begin(uvIt); uvIt != mesh.tessface_uv_textures.end(); ++uvIt) {
-				BL::MeshTextureFaceLayer  uvLayer(*uvIt);
-				const std::string &uvLayerName = uvLayer.name();
-
-				// Setup channel data storage
-				AttrMapChannels::AttrMapChannel &map_channel = map_channels.data[uvLayerName];
-				map_channel.name = uvLayerName;
-				map_channel.vertices.resize(num_faces * 3);
-				map_channel.faces.resize(num_faces * 3);
-			}
-
-			BL::Mesh::tessface_vertex_colors_iterator colIt;
-			for(mesh.tessface_vertex_colors.begin(colIt); colIt != mesh.tessface_vertex_colors.end(); ++colIt) {
-				BL::MeshColorLayer  colLayer(*colIt);
-				const std::string &colLayerName = colLayer.name();
-
-				// Setup channel data storage
-				AttrMapChannels::AttrMapChannel &map_channel = map_channels.data[colLayerName];
-				map_channel.name = colLayerName;
-				map_channel.vertices.resize(num_faces * 3);
-				map_channel.faces.resize(num_faces * 3);
-			}
-
-			// Fill data
-			//
-			BL::Mesh::tessfaces_iterator faceIt;
-			int faceIdx = 0;
-			int chanVertIndex = 0;
-			for (mesh.tessfaces.begin(faceIt); faceIt != mesh.tessfaces.end(); ++faceIt, ++faceIdx) {
-				BlFace faceVerts = faceIt->vertices_raw();
-
-				for(mesh.tessface_uv_textures.begin(uvIt); uvIt != mesh.tessface_uv_textures.end(); ++uvIt) {
-					BL::MeshTextureFaceLayer  uvLayer(*uvIt);
-					const std::string &uvLayerName = uvLayer.name();
-
-					AttrMapChannels::AttrMapChannel &uv_channel = map_channels.data[uvLayerName];
-
-					AttrVector v0(uvLayer.data[faceIdx].uv1());
-					AttrVector v1(uvLayer.data[faceIdx].uv2());
-					AttrVector v2(uvLayer.data[faceIdx].uv3());
-					v0.z = v1.z = v2.z = 0.f;
-
-					(*uv_channel.vertices)[chanVertIndex+0] = v0;
-					(*uv_channel.vertices)[chanVertIndex+1] = v1;
-					(*uv_channel.vertices)[chanVertIndex+2] = v2;
-
-					if (faceVerts[3]) {
-						AttrVector v3(uvLayer.data[faceIdx].uv4());
-						v3.z = 0.f;
-
-						(*uv_channel.vertices)[chanVertIndex+3] = v0;
-						(*uv_channel.vertices)[chanVertIndex+4] = v2;
-						(*uv_channel.vertices)[chanVertIndex+5] = v3;
-					}
-				}
+	const int numCorners = corners.vertices.getCount();
+	const AttrVector *cornerValues = *corners.vertices;
 
-				for(mesh.tessface_vertex_colors.begin(colIt); colIt != mesh.tessface_vertex_colors.end(); ++colIt) {
-					BL::MeshColorLayer  colLayer(*colIt);
-					const std::string &colLayerName = colLayer.name();
+	static_assert(sizeof(AttrVector) == 3 * sizeof(float), "AttrVector must be 3 packed floats");
 
-					AttrMapChannels::AttrMapChannel &col_channel = map_channels.data[colLayerName];
+	map_channel.faces.resize(numCorners);
+	std::vector<int> uniqueSources(numCorners);
 
-					const AttrVector v0(colLayer.data[faceIdx].color1());
-					const AttrVector v1(colLayer.data[faceIdx].color2());
-					const AttrVector v2(colLayer.data[faceIdx].color3());
+	const int numUnique = WeldVectors(reinterpret_cast<const float(*)[3]>(cornerValues), numCorners,
+	                                  *map_channel.faces, uniqueSources.data());
 
-					(*col_channel.vertices)[chanVertIndex+0] = v0;
-					(*col_channel.vertices)[chanVertIndex+1] = v1;
-					(*col_channel.vertices)[chanVertIndex+2] = v2;
-
-					if (faceVerts[3]) {
-						const AttrVector v3(colLayer.data[faceIdx].color4());
-
-						(*col_channel.vertices)[chanVertIndex+3] = v0;
-						(*col_channel.vertices)[chanVertIndex+4] = v2;
-						(*col_channel.vertices)[chanVertIndex+5] = v3;
-					}
-				}
+	map_channel.vertices.resize(numUnique);
+	AttrVector *vertices = *map_channel.vertices;
+	for (int i = 0; i < numUnique; ++i) {
+		vertices[i] = cornerValues[uniqueSources[i]];
+	}
+}
 
-				chanVertIndex += faceVerts[3] ? 6 : 3;
-			}
 
-			// Setup face data
-			for (auto &mcIt : map_channels.data) {
-				for (int i = 0; i < int(mcIt.second.faces.getData()->size()); ++i) {
-					(*mcIt.second.faces)[i] = i;
-				}
-			}
-
-			// Store channel names
-			map_channels_names.resize(num_channels);
-			int i = 0;
-			for (const auto &mcIt : map_channels.data) {
-				(*map_channels_names)[i++] = mcIt.second.name;
-			}
-		}
-	}
+/// Data for welding the map channels of a mesh in parallel
+struct MapChannelMergeTask {
+	ChannelCorners                   *channels;
+	AttrMapChannels::AttrMapChannel **channelsData;
 };
 
 
-struct MapChannelMerge:
-        MapChannelBase
+static void MapChannelMergeRange(void *__restrict userdata, const int c, const ParallelRangeTLS *__restrict)
 {
-	MapChannelMerge(BL::Mesh mesh, int numFaces):
-	    MapChannelBase(mesh, numFaces)
-	{}
-
-	virtual void init() override {
-		if (num_channels) {
-
-			BL::Mesh::tessfaces_iterator faceIt;
-			int faceIdx = 0;
-			for (mesh.tessfaces.begin(faceIt); faceIt != mesh.tessfaces.end(); ++faceIt, ++faceIdx) {
-				BlFace faceVerts = faceIt->vertices_raw();
-
-				BL::Mesh::tessface_uv_textures_iterator uvIt;
-				for(mesh.tessface_uv_textures.begin(uvIt); uvIt != mesh.tessface_uv_textures.end(); ++uvIt) {
-					BL::MeshTextureFaceLayer uvLayer(*uvIt);
-
-					const std::string &layerName = uvLayer.name();
-
-					ChanSet &uvSet = chan_data[layerName];
-
-					uvSet.insert(ChanVertex(uvLayer.data[faceIdx].uv1()));
-					uvSet.insert(ChanVertex(uvLayer.data[faceIdx].uv2()));
-					uvSet.insert(ChanVertex(uvLayer.data[faceIdx].uv3()));
-
-					if (faceVerts[3]) {
-						uvSet.insert(ChanVertex(uvLayer.data[faceIdx].uv4()));
-					}
-				}
+	const MapChannelMergeTask &task = *reinterpret_cast<const MapChannelMergeTask*>(userdata);
+	MapChannelMerge(task.channels[c], *task.channelsData[c]);
+}
 
-				BL::Mesh::tessface_vertex_colors_iterator colIt;
-				for(mesh.tessface_vertex_colors.begin(colIt); colIt != mesh.tessface_vertex_colors.end(); ++colIt) {
-					BL::MeshColorLayer colLayer(*colIt);
 
-					const std::string &layerName = colLayer.name();
+/// Get the values of all UV and vertex color layers for each corner of @looptri
+static void GetChannelsCorners(const ::Mesh &me, const MLoopTri *looptri, int numFaces, ChannelsCorners &channels)
+{
+	const int numCorners = numFaces * 3;
 
-					ChanSet &colSet = chan_data[layerName];
+	for (int l = 0; l < me.ldata.totlayer; ++l) {
+		const CustomDataLayer &layer = me.ldata.layers[l];
 
-					colSet.insert(ChanVertex(colLayer.data[faceIdx].color1()));
-					colSet.insert(ChanVertex(colLayer.data[faceIdx].color2()));
-					colSet.insert(ChanVertex(colLayer.data[faceIdx].color3()));
+		if (layer.type == CD_MLOOPUV) {
+			channels.emplace_back(layer.name, numCorners);
+			const MLoopUV *loopUV = reinterpret_cast<const MLoopUV*>(layer.data);
+			AttrVector *dest = *channels.back().vertices;
 
-					if (faceVerts[3]) {
-						colSet.insert(ChanVertex(colLayer.data[faceIdx].color4()));
-					}
+			for (int f = 0; f < numFaces; ++f) {
+				for (int c = 0; c < 3; ++c) {
+					const float *uv = loopUV[looptri[f].tri[c]].uv;
+					dest[f * 3 + c] = AttrVector(uv[0], uv[1], 0.0f);
 				}
 			}
 		}
-	}
-
-	virtual void init_attributes(AttrListString &map_channels_names, AttrMapChannels &map_channels) override {
-		if (num_channels) {
-			for (ChanMap::iterator setsIt = chan_data.begin(); setsIt != chan_data.end(); ++setsIt) {
-				const std::string &chan_name = setsIt->first;
-				ChanSet           &chan_data = setsIt->second;
-
-				// Setup channel data storage
-				AttrMapChannels::AttrMapChannel &map_channel = map_channels.data[chan_name];
-				map_channel.name = chan_name;
-				map_channel.vertices.resize(chan_data.size());
-				map_channel.faces.resize(num_faces * 3);
-
-				int f = 0;
-				for (ChanSet::iterator setIt = chan_data.begin(); setIt != chan_data.end(); ++setIt, ++f) {
-					const ChanVertex &map_vertex = *setIt;
-
-					// Set vertex index for lookup from faces
-					map_vertex.index = f;
-
-					// Store channel vertex
-					(*map_channel.vertices)[f] = map_vertex.v;
+		else if (layer.type == CD_MLOOPCOL) {
+			channels.emplace_back(layer.name, numCorners);
+			const MLoopCol *loopCol = reinterpret_cast<const MLoopCol*>(layer.data);
+			AttrVector *dest = *channels.back().vertices;
+
+			const float toFloat = 1.0f / 255.0f;
+			for (int f = 0; f < numFaces; ++f) {
+				for (int c = 0; c < 3; ++c) {
+					const MLoopCol &col = loopCol[looptri[f].tri[c]];
+					dest[f * 3 + c] = AttrVector(col.r * toFloat, col.g * toFloat, col.b * toFloat);
 				}
 			}
-
-			// Store channel names
-			map_channels_names.resize(num_channels);
-			int i = 0;
-			for (const auto &mcIt : map_channels.data) {
-				(*map_channels_names)[i++] = mcIt.second.name;
-			}
 		}
 	}
-
-	virtual bool needProcessFaces() const override { return true; }
-
-	virtual int get_map_face_vertex_index(const std::string &layerName, const ChanVertex &cv) override {
-		return chan_data[layerName].find(cv)->index;
-	}
-
-private:
-	ChanMap  chan_data;
-
-};
+}
 
 static int getThreadID()
 {
@@ -326,85 +163,116 @@ VRayForBlender::Mesh::MeshExportResult VRayForBlender::Mesh::FillMeshData(BL::Bl
 
 	// getLog().info("[%i] \"%s\"", getThreadID(), ob.name().c_str());
 
-	ScopedTraceFormat trace("Waiting for WRITE_LOCK_BLENDER for object (%s)", ob.name().c_str());
-	WRITE_LOCK_BLENDER_RAII;
-	trace.dump();
-
-	SCOPED_TRACE_EX("Exporting mesh for object (%s)", ob.name().c_str());
-	struct ResetModOnExit {
-		~ResetModOnExit() {
-			if (mod) {
-				mod.show_render(showRender);
-				mod.show_viewport(showViewport);
+	// Only creating / removing the temporary mesh modifies Blender data and needs the lock,
+	// reading the mesh arrays and filling the attributes is done without it, so meshes of
+	// different objects can be converted in parallel.
+	struct TempMesh {
+		TempMesh(BL::BlendData data)
+			: data(data)
+			, mesh(PointerRNA_NULL)
+		{}
+
+		~TempMesh() {
+			if (mesh) {
+				WRITE_LOCK_BLENDER_RAII;
+				data.meshes.remove(mesh, false, true, false);
 			}
 		}
 
-		bool showRender;
-		bool showViewport;
-		BL::Modifier mod;
-	} modReseter = { false, false, BL::Modifier(PointerRNA_NULL) };
+		BL::BlendData data;
+		BL::Mesh      mesh;
+	} tempMesh(data);
 
-	if (ob.modifiers.length() > 0) {
-		BL::Object::modifiers_iterator iter;
-		for (ob.modifiers.begin(iter); iter != ob.modifiers.end(); ++iter) {
-			if (*iter && iter->type() == BL::Modifier::type_SUBSURF) {
-				options.merge_channel_vertices = true;
+	{
+		ScopedTraceFormat trace("Waiting for WRITE_LOCK_BLENDER for object (%s)", ob.name().c_str());
+		WRITE_LOCK_BLENDER_RAII;
+		trace.dump();
+
+		SCOPED_TRACE_EX("Evaluating mesh for object (%s)", ob.name().c_str());
+		struct ResetModOnExit {
+			~ResetModOnExit() {
+				if (mod) {
+					mod.show_render(showRender);
+					mod.show_viewport(showViewport);
+				}
+			}
+
+			bool showRender;
+			bool showViewport;
+			BL::Modifier mod;
+		} modReseter = { false, false, BL::Modifier(PointerRNA_NULL) };
+
+		if (ob.modifiers.length() > 0) {
+			BL::Object::modifiers_iterator iter;
+			for (ob.modifiers.begin(iter); iter != ob.modifiers.end(); ++iter) {
+				if (*iter && iter->type() == BL::Modifier::type_SUBSURF) {
+					options.merge_channel_vertices = true;
+				}
 			}
-		}
 
-		auto lastMod = ob.modifiers[ob.modifiers.length() - 1];
-		if (options.use_subsurf_to_osd && lastMod && lastMod.type() == BL::Modifier::type_SUBSURF) {
-			modReseter.showRender = lastMod.show_render();
-			modReseter.showViewport = lastMod.show_viewport();
-			modReseter.mod = lastMod;
-
-			// disable them so mesh data does not have this already done
-			lastMod.show_render(false);
-			lastMod.show_viewport(false);
-
-			BL::SubsurfModifier subS(lastMod);
-			if (options.mode == EvalMode::EvalModePreview) {
-				pluginDesc.add("osd_subdiv_level", subS.levels());
-			} else {
-				pluginDesc.add("osd_subdiv_level", subS.render_levels());
+			auto lastMod = ob.modifiers[ob.modifiers.length() - 1];
+			if (options.use_subsurf_to_osd && lastMod && lastMod.type() == BL::Modifier::type_SUBSURF) {
+				modReseter.showRender = lastMod.show_render();
+				modReseter.showViewport = lastMod.show_viewport();
+				modReseter.mod = lastMod;
+
+				// disable them so mesh data does not have this already done
+				lastMod.show_render(false);
+				lastMod.show_viewport(false);
+
+				BL::SubsurfModifier subS(lastMod);
+				if (options.mode == EvalMode::EvalModePreview) {
+					pluginDesc.add("osd_subdiv_level", subS.levels());
+				} else {
+					pluginDesc.add("osd_subdiv_level", subS.render_levels());
+				}
+				pluginDesc.add("osd_subdiv_type", subS.subdivision_type() == BL::SubsurfModifier::subdivision_type_CATMULL_CLARK ? 0 : 1);
+				pluginDesc.add("osd_subdiv_uvs", subS.use_subsurf_uv());
+				pluginDesc.add("osd_subdiv_enable", true);
 			}
-			pluginDesc.add("osd_subdiv_type", subS.subdivision_type() == BL::SubsurfModifier::subdivision_type_CATMULL_CLARK ? 0 : 1);
-			pluginDesc.add("osd_subdiv_uvs", subS.use_subsurf_uv());
-			pluginDesc.add("osd_subdiv_enable", true);
 		}
-	}
 
-	BL::Mesh mesh = data.meshes.new_from_object(scene, ob, true, options.mode, false, false);
-	if (!mesh) {
-		getLog().error("Object: %s => Incorrect mesh!",
-			ob.name().c_str());
-		return MeshExportResult::error;
-	}
+		tempMesh.mesh = data.meshes.new_from_object(scene, ob, true, options.mode, false, false);
+		if (!tempMesh.mesh) {
+			getLog().error("Object: %s => Incorrect mesh!",
+				ob.name().c_str());
+			return MeshExportResult::error;
+		}
 
-	const int useAutoSmooth = mesh.use_auto_smooth();
-	if (useAutoSmooth) {
-		mesh.calc_normals_split();
+		// This allocates derived data of the new mesh, keep it with the mesh creation
+		if (!options.vertices_only && tempMesh.mesh.use_auto_smooth()) {
+			tempMesh.mesh.calc_normals_split();
+		}
 	}
-	mesh.calc_tessface(true);
 
-	BL::Mesh::tessfaces_iterator faceIt;
-	int numFaces  = 0;
-	for (mesh.tessfaces.begin(faceIt); faceIt != mesh.tessfaces.end(); ++faceIt) {
-		BlFace faceVerts = faceIt->vertices_raw();
-
-		// If face is quad we split it into 2 tris
-		numFaces += faceVerts[3] ? 2 : 1;
-	}
+	SCOPED_TRACE_EX("Exporting mesh for object (%s)", ob.name().c_str());
 
-	if (numFaces == 0) {
-		::Mesh *rawMesh = reinterpret_cast<::Mesh*>(ob.data().ptr.data);
+	// Read the mesh arrays directly instead of going trough RNA for each face
+	const ::Mesh &me = *reinterpret_cast<const ::Mesh*>(tempMesh.mesh.ptr.data);
+	const MVert *mvert = me.mvert;
+	const MLoop *mloop = me.mloop;
+	const MPoly *mpoly = me.mpoly;
 
-		data.meshes.remove(mesh, false, true, false);
+	const int numFaces = poly_to_tri_count(me.totpoly, me.totloop);
+	if (numFaces <= 0 || !mvert || !mloop || !mpoly) {
 		getLog().warning("Object: %s => Empty mesh!", ob.name().c_str());
 		return MeshExportResult::error;
 	}
 
-	AttrListVector  vertices(mesh.vertices.length());
+	if (options.vertices_only) {
+		AttrListVector vertices(me.totvert);
+		AttrVector *verticesData = *vertices;
+		for (int v = 0; v < me.totvert; ++v) {
+			verticesData[v] = AttrVector(mvert[v].co[0], mvert[v].co[1], mvert[v].co[2]);
+		}
+		pluginDesc.add("vertices", vertices);
+		return MeshExportResult::exported;
+	}
+
+	std::vector<MLoopTri> looptri(numFaces);
+	BKE_mesh_recalc_looptri(mloop, mpoly, mvert, me.totloop, me.totpoly, looptri.data());
+
+	AttrListVector  vertices(me.totvert);
 	AttrListInt     faces(numFaces * 3);
 	AttrListVector  normals(numFaces * 3);
 	AttrListInt     faceNormals(numFaces * 3);
@@ -414,187 +282,111 @@ VRayForBlender::Mesh::MeshExportResult VRayForBlender::Mesh::FillMeshData(BL::Bl
 	AttrListString  map_channels_names;
 	AttrMapChannels map_channels;
 
-	MapChannelBase *channels_data = nullptr;
-	MapChannelMerge mergeMapChannel(mesh, numFaces);
-	MapChannelRaw rawMapChannel(mesh, numFaces);
-	if (options.merge_channel_vertices) {
-		channels_data = &mergeMapChannel;
-	} else {
-		channels_data = &rawMapChannel;
-	}
-	channels_data->init();
-	channels_data->init_attributes(map_channels_names, map_channels);
-
 	memset((*edge_visibility), 0, edge_visibility.getBytesCount());
 
-	BL::Mesh::vertices_iterator vertIt;
-	int vertexIndex = 0;
-	for (mesh.vertices.begin(vertIt); vertIt != mesh.vertices.end(); ++vertIt, ++vertexIndex) {
-		(*vertices)[vertexIndex].x = vertIt->co()[0];
-		(*vertices)[vertexIndex].y = vertIt->co()[1];
-		(*vertices)[vertexIndex].z = vertIt->co()[2];
+	AttrVector *verticesData = *vertices;
+	for (int v = 0; v < me.totvert; ++v) {
+		verticesData[v] = AttrVector(mvert[v].co[0], mvert[v].co[1], mvert[v].co[2]);
 	}
 
-	int normalIndex   = 0;
-	int faceNormIndex = 0;
-	int faceVertIndex = 0;
-	int faceCount     = 0;
-	int edgeVisIndex  = 0;
-	int chanVertIndex = 0;
-	int faceIdx       = 0;
-	for (mesh.tessfaces.begin(faceIt); faceIt != mesh.tessfaces.end(); ++faceIt, ++faceIdx) {
-		BlFace faceVerts = faceIt->vertices_raw();
-		typedef BL::Array<float, 3> Normal;
-		// Normals
-		float n0[3] = {0.0f, 0.0f, 0.0f};
-		float n1[3] = {0.0f, 0.0f, 0.0f};
-		float n2[3] = {0.0f, 0.0f, 0.0f};
-		float n3[3] = {0.0f, 0.0f, 0.0f};
-
-		if (useAutoSmooth) {
-			const BL::Array<float, 12> &autoNo = faceIt->split_normals();
-
-			copy_v3_v3(n0, &autoNo.data[0 * 3]);
-			copy_v3_v3(n1, &autoNo.data[1 * 3]);
-			copy_v3_v3(n2, &autoNo.data[2 * 3]);
-			if (faceVerts[3]) {
-				copy_v3_v3(n3, &autoNo.data[3 * 3]);
-			}
-		}
-		else {
-			if (faceIt->use_smooth()) {
-				Normal f0Normal = mesh.vertices[faceVerts[0]].normal();
-				Normal f1Normal = mesh.vertices[faceVerts[1]].normal();
-				Normal f2Normal = mesh.vertices[faceVerts[2]].normal();
-
-				copy_v3_v3(n0, &f0Normal.data[0]);
-				copy_v3_v3(n1, &f1Normal.data[0]);
-				copy_v3_v3(n2, &f2Normal.data[0]);
-				if (faceVerts[3]) {
-					Normal f3Normal = mesh.vertices[faceVerts[3]].normal();
-					copy_v3_v3(n3, &f3Normal.data[0]);
-				}
-			}
-			else {
-				float fno[3];
-				Normal faceNormal = faceIt->normal();
-				copy_v3_v3(fno, &faceNormal.data[0]);
-
-				copy_v3_v3(n0, fno);
-				copy_v3_v3(n1, fno);
-				copy_v3_v3(n2, fno);
-
-				if (faceVerts[3]) {
-					copy_v3_v3(n3, fno);
-				}
+	// Split normals are only there if calc_normals_split() was called for auto smooth
+	const float (*loopNormals)[3] = me.flag & ME_AUTOSMOOTH
+		? reinterpret_cast<const float(*)[3]>(CustomData_get_layer(&me.ldata, CD_NORMAL))
+		: nullptr;
+
+	std::vector<AttrVector> polyNormals;
+	if (!loopNormals) {
+		polyNormals.resize(me.totpoly);
+		for (int p = 0; p < me.totpoly; ++p) {
+			if (!(mpoly[p].flag & ME_SMOOTH)) {
+				BKE_mesh_calc_poly_normal(&mpoly[p], &mloop[mpoly[p].loopstart], mvert, &polyNormals[p].x);
 			}
 		}
+	}
 
-		// Store normals / face normals
-		(*faceNormals)[faceNormIndex++] = normalIndex;
-		(*normals)[normalIndex++] = n0;
-		(*faceNormals)[faceNormIndex++] = normalIndex;
-		(*normals)[normalIndex++] = n1;
-		(*faceNormals)[faceNormIndex++] = normalIndex;
-		(*normals)[normalIndex++] = n2;
-		if (faceVerts[3]) {
-			(*faceNormals)[faceNormIndex++] = normalIndex;
-			(*normals)[normalIndex++] = n0;
-			(*faceNormals)[faceNormIndex++] = normalIndex;
-			(*normals)[normalIndex++] = n2;
-			(*faceNormals)[faceNormIndex++] = normalIndex;
-			(*normals)[normalIndex++] = n3;
-		}
-
-		// Material ID
-		const int matID = faceIt->material_index() + 1;
-
-		// Store face vertices
-		(*faces)[faceVertIndex++] = faceVerts[0];
-		(*faces)[faceVertIndex++] = faceVerts[1];
-		(*faces)[faceVertIndex++] = faceVerts[2];
-
-		(*face_mtlIDs)[faceCount++] = matID;
-
-		if (faceVerts[3]) {
-			(*faces)[faceVertIndex++] = faceVerts[0];
-			(*faces)[faceVertIndex++] = faceVerts[2];
-			(*faces)[faceVertIndex++] = faceVerts[3];
-
-			(*face_mtlIDs)[faceCount++] = matID;
-		}
-
-		// Store edge visibility
-		if (faceVerts[3]) {
-			(*edge_visibility)[edgeVisIndex/10] |= (3 << ((edgeVisIndex%10)*3));
-			edgeVisIndex++;
-			(*edge_visibility)[edgeVisIndex/10] |= (6 << ((edgeVisIndex%10)*3));
-			edgeVisIndex++;
-		}
-		else {
-			(*edge_visibility)[edgeVisIndex/10] |= (7 << ((edgeVisIndex%10)*3));
-			edgeVisIndex++;
-		}
-
-		// Store UV / vertex colors
-		if (channels_data->numChannels() && channels_data->needProcessFaces()) {
-			const int channel_vert_index = chanVertIndex;
-
-			BL::Mesh::tessface_uv_textures_iterator uvIt;
-			for (mesh.tessface_uv_textures.begin(uvIt); uvIt != mesh.tessface_uv_textures.end(); ++uvIt) {
-				BL::MeshTextureFaceLayer uvLayer(*uvIt);
-
-				const std::string &layerName = uvLayer.name();
-
-				AttrListInt &uvData = map_channels.data[layerName].faces;
+	int          *facesData       = *faces;
+	AttrVector   *normalsData     = *normals;
+	int          *faceNormalsData = *faceNormals;
+	int          *mtlIDsData      = *face_mtlIDs;
+	int          *edgeVisData     = *edge_visibility;
 
-				const int v0 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(uvLayer.data[faceIdx].uv1()));
-				const int v1 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(uvLayer.data[faceIdx].uv2()));
-				const int v2 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(uvLayer.data[faceIdx].uv3()));
+	for (int f = 0; f < numFaces; ++f) {
+		const MLoopTri &lt = looptri[f];
+		const MPoly &poly = mpoly[lt.poly];
 
-				(*uvData)[channel_vert_index+0] = v0;
-				(*uvData)[channel_vert_index+1] = v1;
-				(*uvData)[channel_vert_index+2] = v2;
+		int edgeVis = 0;
+		for (int c = 0; c < 3; ++c) {
+			const unsigned int loop = lt.tri[c];
+			const int corner = f * 3 + c;
 
-				if (faceVerts[3]) {
-					const int v3 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(uvLayer.data[faceIdx].uv4()));
+			facesData[corner] = mloop[loop].v;
+			faceNormalsData[corner] = corner;
 
-					(*uvData)[channel_vert_index+3] = v0;
-					(*uvData)[channel_vert_index+4] = v2;
-					(*uvData)[channel_vert_index+5] = v3;
-				}
+			if (loopNormals) {
+				normalsData[corner] = AttrVector(loopNormals[loop][0], loopNormals[loop][1], loopNormals[loop][2]);
+			}
+			else if (poly.flag & ME_SMOOTH) {
+				float no[3];
+				normal_short_to_float_v3(no, mvert[mloop[loop].v].no);
+				normalsData[corner] = AttrVector(no[0], no[1], no[2]);
+			}
+			else {
+				normalsData[corner] = polyNormals[lt.poly];
 			}
 
-			BL::Mesh::tessface_vertex_colors_iterator colIt;
-			for (mesh.tessface_vertex_colors.begin(colIt); colIt != mesh.tessface_vertex_colors.end(); ++colIt) {
-				BL::MeshColorLayer colLayer(*colIt);
-
-				const std::string &layerName = colLayer.name();
-
-				AttrListInt &colData = map_channels.data[layerName].faces;
+			// Edge from this corner to the next one is visible if it is an edge of the polygon and not
+			// a diagonal added by the triangulation
+			const unsigned int nextLoop = lt.tri[(c + 1) % 3];
+			const unsigned int polyNext = poly.loopstart + (loop - poly.loopstart + 1) % poly.totloop;
+			if (nextLoop == polyNext) {
+				edgeVis |= 1 << c;
+			}
+		}
 
-				const int v0 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(colLayer.data[faceIdx].color1()));
-				const int v1 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(colLayer.data[faceIdx].color2()));
-				const int v2 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(colLayer.data[faceIdx].color3()));
+		mtlIDsData[f] = poly.mat_nr + 1;
+		edgeVisData[f / 10] |= edgeVis << ((f % 10) * 3);
+	}
 
-				(*colData)[channel_vert_index+0] = v0;
-				(*colData)[channel_vert_index+1] = v1;
-				(*colData)[channel_vert_index+2] = v2;
+	ChannelsCorners channels;
+	GetChannelsCorners(me, looptri.data(), numFaces, channels);
 
-				if (faceVerts[3]) {
-					const int v3 = channels_data->get_map_face_vertex_index(layerName, ChanVertex(colLayer.data[faceIdx].color4()));
+	// UV and color layers with the same name end up in one channel, only the first one is exported
+	std::vector<AttrMapChannels::AttrMapChannel*> channelsData;
+	for (auto cIt = channels.begin(); cIt != channels.end();) {
+		if (map_channels.data.count(cIt->name)) {
+			cIt = channels.erase(cIt);
+			continue;
+		}
+		AttrMapChannels::AttrMapChannel &map_channel = map_channels.data[cIt->name];
+		map_channel.name = cIt->name;
+		channelsData.push_back(&map_channel);
+		++cIt;
+	}
 
-					(*colData)[channel_vert_index+3] = v0;
-					(*colData)[channel_vert_index+4] = v2;
-					(*colData)[channel_vert_index+5] = v3;
-				}
-			}
+	if (options.merge_channel_vertices && !channels.empty()) {
+		// Channels are independent, weld big ones in parallel on Blender's task pool
+		MapChannelMergeTask task;
+		task.channels     = channels.data();
+		task.channelsData = channelsData.data();
 
-			chanVertIndex += faceVerts[3] ? 6 : 3;
+		ParallelRangeSettings settings;
+		BLI_parallel_range_settings_defaults(&settings);
+		settings.use_threading = channels.size() > 1 && numFaces * 3 >= ParallelWeldMinCorners;
+		BLI_task_parallel_range(0, static_cast<int>(channels.size()), &task, MapChannelMergeRange, &settings);
+	} else {
+		for (int c = 0; c < static_cast<int>(channels.size()); ++c) {
+			MapChannelRaw(channels[c], *channelsData[c]);
 		}
 	}
 
-	data.meshes.remove(mesh, false, true, false);
+	if (!map_channels.data.empty()) {
+		// Store channel names
+		map_channels_names.resize(map_channels.data.size());
+		int i = 0;
+		for (const auto &mcIt : map_channels.data) {
+			(*map_channels_names)[i++] = mcIt.second.name;
+		}
+	}
 
 	pluginDesc.add("vertices", vertices);
 	pluginDesc.add("faces", faces);
@@ -603,7 +395,7 @@ VRayForBlender::Mesh::MeshExportResult VRayForBlender::Mesh::FillMeshData(BL::Bl
 	pluginDesc.add("face_mtlIDs", face_mtlIDs);
 	pluginDesc.add("edge_visibility", edge_visibility);
 
-	if (channels_data->numChannels()) {
+	if (!map_channels.data.empty()) {
 		pluginDesc.add("map_channels_names", map_channels_names);
 		pluginDesc.add("map_channels",       map_channels);
 	}
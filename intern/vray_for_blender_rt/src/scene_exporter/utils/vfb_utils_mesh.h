@@ -40,12 +40,14 @@ struct ExportOptions {
 	    , merge_channel_vertices(false)
 	    , force_dynamic_geometry(false)
 	    , use_subsurf_to_osd(false)
+	    , vertices_only(false)
 	{}
 
 	EvalMode mode;
 	bool     merge_channel_vertices;
 	bool     force_dynamic_geometry;
 	bool     use_subsurf_to_osd;
+	bool     vertices_only; ///< Fill only "vertices", for motion blur samples used to compute velocities
 };
 
 MeshExportResult FillMeshData(BL::BlendData data,
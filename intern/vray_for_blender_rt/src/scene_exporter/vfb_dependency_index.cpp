@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vfb_dependency_index.h"
+#include "vfb_utils_blender.h"
+#include "vfb_utils_nodes.h"
+
+#include <deque>
+
+using namespace VRayForBlender;
+
+
+void DependencyIndex::clear()
+{
+	m_objects.clear();
+	m_materials.clear();
+	m_objectUsers.clear();
+	m_dataUsers.clear();
+}
+
+
+void DependencyIndex::addUser(UsersMap &users, IdKey used, IdKey user)
+{
+	if (used && used != user) {
+		users[used].insert(user);
+	}
+}
+
+
+void DependencyIndex::addNodeTreeUser(BL::NodeTree ntree, IdKey user, HashSet<IdKey> &visited, std::vector<IdKey> &uses)
+{
+	if (!ntree) {
+		return;
+	}
+
+	const IdKey treeKey = key(ntree);
+	addUser(m_dataUsers, treeKey, user);
+	uses.push_back(treeKey);
+
+	if (!visited.insert(treeKey).second) {
+		return;
+	}
+
+	// an update of a group's tree does not tag the trees using it
+	for (auto node : Blender::collection(ntree.nodes)) {
+		if (node.is_a(&RNA_ShaderNodeGroup) || node.is_a(&RNA_NodeCustomGroup)) {
+			std::vector<IdKey> groupUses;
+			addNodeTreeUser(Nodes::GetGroupNodeTree(node), treeKey, visited, groupUses);
+		}
+	}
+}
+
+
+void DependencyIndex::addNodeTree(BL::NodeTree ntree)
+{
+	HashSet<IdKey> visited;
+	visited.insert(key(ntree));
+	for (auto node : Blender::collection(ntree.nodes)) {
+		if (node.is_a(&RNA_ShaderNodeGroup) || node.is_a(&RNA_NodeCustomGroup)) {
+			std::vector<IdKey> groupUses;
+			addNodeTreeUser(Nodes::GetGroupNodeTree(node), key(ntree), visited, groupUses);
+		}
+	}
+}
+
+
+void DependencyIndex::removeObject(IdKey obKey)
+{
+	auto obIt = m_objects.find(obKey);
+	if (obIt == m_objects.end()) {
+		return;
+	}
+
+	for (IdKey used : obIt->second.objectUses) {
+		auto usersIt = m_objectUsers.find(used);
+		if (usersIt != m_objectUsers.end()) {
+			usersIt->second.erase(obKey);
+		}
+	}
+	for (IdKey used : obIt->second.dataUses) {
+		auto usersIt = m_dataUsers.find(used);
+		if (usersIt != m_dataUsers.end()) {
+			usersIt->second.erase(obKey);
+		}
+	}
+	m_objects.erase(obIt);
+}
+
+
+void DependencyIndex::addObject(BL::Object ob, bool visible)
+{
+	const IdKey obKey = key(ob);
+	removeObject(obKey);
+
+	ObjectState &state = m_objects[obKey];
+	state.object = ob;
+	state.name = ob.name();
+	state.visible = visible;
+
+	// the same checks as Blender::getObjectUpdateState
+	if (BL::Object parent = ob.parent()) {
+		state.objectUses.push_back(key(parent));
+	}
+	if (BL::Group group = ob.dupli_group()) {
+		for (auto groupOb : Blender::collection(group.objects)) {
+			state.objectUses.push_back(key(groupOb));
+		}
+	}
+	for (IdKey used : state.objectUses) {
+		addUser(m_objectUsers, used, obKey);
+	}
+
+	HashSet<IdKey> visited;
+	BL::ID data(ob.data());
+	if (data) {
+		state.dataUses.push_back(key(data));
+		addUser(m_dataUsers, key(data), obKey);
+		if (Blender::IsLight(ob)) {
+			addNodeTreeUser(Nodes::GetNodeTree(data), obKey, visited, state.dataUses);
+		}
+	}
+	addNodeTreeUser(Nodes::GetNodeTree(ob), obKey, visited, state.dataUses);
+
+	// materials are exported by name, so objects need no export for material updates
+	for (auto slot : Blender::collection(ob.material_slots)) {
+		BL::Material ma(slot.material());
+		if (ma) {
+			m_materials.insert(key(ma));
+			std::vector<IdKey> materialUses;
+			addNodeTreeUser(Nodes::GetNodeTree(ma), key(ma), visited, materialUses);
+		}
+	}
+}
+
+
+const DependencyIndex::ObjectState * DependencyIndex::getObject(BL::Object ob) const
+{
+	auto obIt = m_objects.find(key(ob));
+	return obIt == m_objects.end() ? nullptr : &obIt->second;
+}
+
+
+void DependencyIndex::collect(const UsersMap &users, const HashSet<IdKey> &ids, Dependents &dependents) const
+{
+	HashSet<IdKey> visited(ids.begin(), ids.end());
+	std::deque<IdKey> queue(ids.begin(), ids.end());
+
+	while (!queue.empty()) {
+		const IdKey used = queue.front();
+		queue.pop_front();
+
+		auto usersIt = users.find(used);
+		if (usersIt == users.end()) {
+			continue;
+		}
+
+		for (IdKey user : usersIt->second) {
+			if (!visited.insert(user).second) {
+				continue;
+			}
+			queue.push_back(user);
+
+			auto obIt = m_objects.find(user);
+			if (obIt != m_objects.end()) {
+				if (dependents.objectKeys.insert(user).second) {
+					dependents.objects.push_back(obIt->second.object);
+				}
+				continue;
+			}
+			if (m_materials.count(user)) {
+				dependents.materialKeys.insert(user);
+			}
+		}
+	}
+}
+
+
+void DependencyIndex::getObjectDependents(const HashSet<IdKey> &objects, Dependents &dependents) const
+{
+	collect(m_objectUsers, objects, dependents);
+}
+
+
+void DependencyIndex::getDataDependents(const HashSet<IdKey> &ids, Dependents &dependents) const
+{
+	collect(m_dataUsers, ids, dependents);
+}
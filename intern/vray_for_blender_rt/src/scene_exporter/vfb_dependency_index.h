@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VRAY_FOR_BLENDER_DEPENDENCY_INDEX_H
+#define VRAY_FOR_BLENDER_DEPENDENCY_INDEX_H
+
+#include "vfb_rna.h"
+#include "vfb_typedefs.h"
+
+namespace VRayForBlender {
+
+/// Reverse index from the IDs used by the scene objects to the objects and materials using them
+/// Used in interactive updates to export only the dependents of the IDs Blender tagged as updated
+/// IDs are keyed by their data pointer, so the index must be rebuilt when Blender reloads data (undo)
+class DependencyIndex {
+public:
+	typedef const void* IdKey;
+
+	/// State of an object when it was last exported
+	struct ObjectState {
+		ObjectState(): object(PointerRNA_NULL), visible(false) {}
+
+		BL::Object          object;
+		std::string         name; ///< Plugin names depend on it so a rename needs export
+		bool                visible; ///< False if the object was skipped for export
+		std::vector<IdKey>  objectUses; ///< Objects this one is updated with (parent, group objects)
+		std::vector<IdKey>  dataUses; ///< Data and node trees this object is exported from
+	};
+
+	/// Dependents found by getObjectDependents and getDataDependents
+	struct Dependents {
+		HashSet<IdKey>  objectKeys;
+		ObList          objects;
+		HashSet<IdKey>  materialKeys; ///< Materials are looked up in BlendData as they are not tracked for removal
+	};
+
+	static IdKey          key(BL::ID id) { return id.ptr.data; }
+
+	void                  clear();
+	bool                  empty() const { return m_objects.empty(); }
+	int                   objectCount() const { return static_cast<int>(m_objects.size()); }
+
+	/// Add @ob or replace its previous state and dependencies
+	/// @param visible - true if @ob was exported, false if it was skipped
+	void                  addObject(BL::Object ob, bool visible);
+
+	/// Get the state @ob was added with, nullptr if it is not in the index
+	const ObjectState *   getObject(BL::Object ob) const;
+
+	/// Add the node trees used by @ntree's group nodes and the trees nested in them
+	/// Called for updated trees, as group nodes could have been added since the index was built
+	void                  addNodeTree(BL::NodeTree ntree);
+
+	/// Collect the objects updated together with @objects: their children and the objects instancing them in a group
+	/// @objects are not included in the result
+	void                  getObjectDependents(const HashSet<IdKey> &objects, Dependents &dependents) const;
+
+	/// Collect the objects and materials using @ids directly or through node groups
+	void                  getDataDependents(const HashSet<IdKey> &ids, Dependents &dependents) const;
+
+private:
+	typedef HashMap<IdKey, HashSet<IdKey>> UsersMap;
+
+	void                  removeObject(IdKey obKey);
+	void                  addUser(UsersMap &users, IdKey used, IdKey user);
+	void                  addNodeTreeUser(BL::NodeTree ntree, IdKey user, HashSet<IdKey> &visited, std::vector<IdKey> &uses);
+	void                  collect(const UsersMap &users, const HashSet<IdKey> &ids, Dependents &dependents) const;
+
+	HashMap<IdKey, ObjectState>   m_objects;
+	HashSet<IdKey>                m_materials;
+	UsersMap                      m_objectUsers; ///< Object -> objects updated with it
+	UsersMap                      m_dataUsers; ///< Data, material or node tree -> objects, materials and trees using it
+};
+
+} // namespace VRayForBlender
+
+#endif // VRAY_FOR_BLENDER_DEPENDENCY_INDEX_H
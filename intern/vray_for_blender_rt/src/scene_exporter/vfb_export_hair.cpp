@@ -24,8 +24,15 @@ extern "C" {
 #include "DNA_modifier_types.h"
 #include "BKE_DerivedMesh.h"
 #include "BKE_particle.h"
+#include "BLI_task.h"
 }
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include <vector>
+
 using namespace VRayForBlender;
 
 // Taken from "source/blender/render/intern/source/convertblender.c" and modified
@@ -50,6 +57,116 @@ BLI_INLINE void GetParticleUV(short from, DerivedMesh *dm, float *fuv, int layer
 }
 
 
+namespace {
+
+/// Number of child strands exported by one parallel task
+const int HairChunkSize = 4096;
+
+/// Transform the positions of @count cache keys by @tm and store them in @dest
+void TransformHairKeys(const float tm[4][4], const ParticleCacheKey *keys, int count, AttrVector *dest)
+{
+#ifdef __SSE2__
+	const __m128 col0 = _mm_loadu_ps(tm[0]);
+	const __m128 col1 = _mm_loadu_ps(tm[1]);
+	const __m128 col2 = _mm_loadu_ps(tm[2]);
+	const __m128 col3 = _mm_loadu_ps(tm[3]);
+
+	for (int c = 0; c < count; ++c) {
+		const float *co = keys[c].co;
+		const __m128 xy = _mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(co[0])), _mm_mul_ps(col1, _mm_set1_ps(co[1])));
+		const __m128 z1 = _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(co[2])), col3);
+
+		float result[4];
+		_mm_storeu_ps(result, _mm_add_ps(xy, z1));
+		dest[c] = AttrVector(result[0], result[1], result[2]);
+	}
+#else
+	for (int c = 0; c < count; ++c) {
+		float *co = &dest[c].x;
+		copy_v3_v3(co, keys[c].co);
+		mul_m4_v3(tm, co);
+	}
+#endif
+}
+
+/// Data shared by all tasks exporting child strands
+struct ChildHairTask {
+	ParticleSystem             *ps;
+	ParticleSettings           *pst;
+	ParticleSystemModifierData *psmd;
+
+	float  itm[4][4];   ///< Inverse of object transform
+	float  width;       ///< Hair width at the root
+	bool   widthFade;   ///< Make strands thinner towards the tip
+	bool   hasUV;       ///< Export strand UVs
+	int    layerIdx;    ///< UV layer index
+
+	int         childTotal;   ///< Number of strands
+	const int  *chunkOffsets; ///< Index of the first vertex of each chunk of HairChunkSize strands
+
+	AttrVector *vertices;
+	float      *widths;
+	AttrVector *uvw;
+};
+
+/// Export strands [chunk * HairChunkSize, (chunk + 1) * HairChunkSize)
+void ExportChildHairChunk(void *__restrict userdata, const int chunk, const ParallelRangeTLS *__restrict)
+{
+	const ChildHairTask &task = *reinterpret_cast<const ChildHairTask*>(userdata);
+	ParticleSystem *ps = task.ps;
+
+	const int strandBegin = chunk * HairChunkSize;
+	const int strandEnd = std::min(task.childTotal, strandBegin + HairChunkSize);
+
+	int hair_vert_index = task.chunkOffsets[chunk];
+	for (int p = strandBegin; p < strandEnd; ++p) {
+		const ParticleCacheKey *child_key = ps->childcache[p];
+
+		// segments is -1 when current particle is virtual
+		const int child_steps = std::max(0, child_key->segments);
+
+		TransformHairKeys(task.itm, child_key, child_steps, task.vertices + hair_vert_index);
+
+		float *widths = task.widths + hair_vert_index;
+		if (task.widthFade) {
+			const float hair_fade_step = task.width / (child_steps + 1);
+			for (int s = 0; s < child_steps; ++s) {
+				widths[s] = std::max(1e-6f, task.width - s * hair_fade_step);
+			}
+		}
+		else {
+			std::fill(widths, widths + child_steps, task.width);
+		}
+
+		hair_vert_index += child_steps;
+
+		if (task.hasUV && child_steps > 0) {
+			float *uv = &task.uvw[p].x;
+			DerivedMesh *dm = task.psmd->dm_final;
+
+			ChildParticle *cpa = ps->child + p;
+			if (task.pst->childtype == PART_CHILD_FACES) {
+				GetParticleUV(PART_FROM_FACE, dm, cpa->fuv, task.layerIdx, cpa->num, uv);
+			}
+			else {
+				ParticleData *parent = ps->particles + cpa->parent;
+
+				int num = parent->num_dmcache;
+				if (num == DMCACHE_NOTFOUND) {
+					if (parent->num < dm->getNumTessFaces(dm)) {
+						num = parent->num;
+					}
+				}
+
+				GetParticleUV(task.pst->from, dm, parent->fuv, task.layerIdx, num, uv);
+			}
+		}
+	}
+}
+
+}
+
+
 AttrValue DataExporter::exportGeomMayaHair(BL::Object ob, BL::ParticleSystem psys, BL::ParticleSystemModifier psm)
 {
 	AttrValue hair;
@@ -74,6 +191,11 @@ AttrValue DataExporter::exportGeomMayaHair(BL::Object ob, BL::ParticleSystem psy
 		totcurves += totparts;
 	}
 
+	const std::string hairName = getHairName(ob, psys, pset);
+	if (totcurves && isVelocityMotionBlurSample() && !beginVelocitySample(hairName)) {
+		return AttrPlugin(hairName);
+	}
+
 	if (totcurves) {
 		float hair_width = 0.001f;
 		int   use_width_fade = false;
@@ -117,71 +239,54 @@ AttrValue DataExporter::exportGeomMayaHair(BL::Object ob, BL::ParticleSystem psy
 			ParticleSystemModifierData *psmd = (ParticleSystemModifierData*)psm.ptr.data;
 
 			ParticleCacheKey **child_cache = ps->childcache;
-			int                child_total = ps->totchildcache;
-			int                tot_verts = 0;
+			const int          child_total = ps->totchildcache;
+			const int          chunk_count = (child_total + HairChunkSize - 1) / HairChunkSize;
 
+			// Count vertices first so all lists are allocated once and chunks know where to write
+			std::vector<int> chunk_offsets(chunk_count + 1, 0);
 			num_hair_vertices.resize(child_total);
 
+			int tot_verts = 0;
 			for (int p = 0; p < child_total; ++p) {
+				if (p % HairChunkSize == 0) {
+					chunk_offsets[p / HairChunkSize] = tot_verts;
+				}
+
 				// segments is -1 when current particle is virtual
 				const int seg_verts = std::max(0, child_cache[p]->segments);
-				tot_verts += std::max(0, seg_verts);
+				tot_verts += seg_verts;
 
 				(*num_hair_vertices)[p] = seg_verts;
 			}
+			chunk_offsets[chunk_count] = tot_verts;
 
 			widths.resize(tot_verts);
 			hair_vertices.resize(tot_verts);
 
 			const bool has_uv = psmd->dm_final && CustomData_number_of_layers(&psmd->dm_final->faceData, CD_MTFACE);
 			if (has_uv) {
-				strand_uvw.resize(tot_verts);
+				strand_uvw.resize(child_total);
 			}
 
-			int hair_vert_index = 0;
-			for(int p = 0; p < child_total; ++p) {
-				ParticleCacheKey *child_key = child_cache[p];
-
-				const int child_steps = child_key->segments;
-
-				float hair_fade_width = hair_width;
-				float hair_fade_step  = hair_width / (child_steps+1);
-
-				for(int s = 0; s < child_steps; ++s, ++child_key) {
-					float *co = (float*)&(*hair_vertices)[hair_vert_index];
-					copy_v3_v3(co, child_key->co);
-					mul_m4_v3(hair_itm, co);
-
-					(*widths)[hair_vert_index] = use_width_fade
-					                             ? std::max(1e-6f, hair_fade_width)
-					                             : hair_width;
-
-					hair_fade_width -= hair_fade_step;
-
-					hair_vert_index++;
-				}
-
-				if (has_uv && child_steps > 0) {
-					float *uv = (float*)&(*strand_uvw)[p];
-
-					ChildParticle *cpa = ps->child + p;
-					if(pst->childtype == PART_CHILD_FACES) {
-						GetParticleUV(PART_FROM_FACE, psmd->dm_final, cpa->fuv, layer_idx, cpa->num, uv);
-					}
-					else {
-						ParticleData *parent = ps->particles + cpa->parent;
-
-						int num = parent->num_dmcache;
-						if (num == DMCACHE_NOTFOUND) {
-							if (parent->num < psmd->dm_final->getNumTessFaces(psmd->dm_final)) {
-								num = parent->num;
-							}
-						}
-
-						GetParticleUV(pst->from, psmd->dm_final, parent->fuv, layer_idx, num, uv);
-					}
-				}
-			}
+			ChildHairTask task;
+			task.ps           = ps;
+			task.pst          = pst;
+			task.psmd         = psmd;
+			memcpy(task.itm, hair_itm, sizeof(hair_itm));
+			task.width        = hair_width;
+			task.widthFade    = use_width_fade;
+			task.hasUV        = has_uv;
+			task.layerIdx     = layer_idx;
+			task.childTotal   = child_total;
+			task.chunkOffsets = chunk_offsets.data();
+			task.vertices     = *hair_vertices;
+			task.widths       = *widths;
+			task.uvw          = has_uv ? *strand_uvw : nullptr;
+
+			ParallelRangeSettings settings;
+			BLI_parallel_range_settings_defaults(&settings);
+			settings.use_threading = chunk_count > 1;
+			BLI_task_parallel_range(0, chunk_count, &task, ExportChildHairChunk, &settings);
 		}
 		else {
 			// Export particles using C++ RNA API
@@ -232,7 +337,7 @@ AttrValue DataExporter::exportGeomMayaHair(BL::Object ob, BL::ParticleSystem psy
 			}
 		}
 
-		PluginDesc hairDesc(getHairName(ob, psys, pset), "GeomMayaHair");
+		PluginDesc hairDesc(hairName, "GeomMayaHair");
 		hairDesc.add("num_hair_vertices", num_hair_vertices);
 		hairDesc.add("hair_vertices", hair_vertices);
 		hairDesc.add("widths", widths);
@@ -242,7 +347,11 @@ AttrValue DataExporter::exportGeomMayaHair(BL::Object ob, BL::ParticleSystem psy
 		hairDesc.add("widths_in_pixels", widths_in_pixels);
 		hairDesc.add("geom_splines", pset.use_hair_bspline());
 
-		hair = m_exporter->export_plugin(hairDesc);
+		if (addVelocities(hairDesc, "hair_vertices")) {
+			hair = m_exporter->export_plugin(hairDesc);
+		} else {
+			hair = AttrPlugin(hairName);
+		}
 	}
 
 	return hair;
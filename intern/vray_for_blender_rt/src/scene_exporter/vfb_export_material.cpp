@@ -31,6 +31,63 @@ void DataExporter::clearMaterialCache()
 }
 
 
+void DataExporter::clearMaterialExportCache()
+{
+	std::lock_guard<std::mutex> mtlLock(m_materials_mtx);
+	m_material_exports.clear();
+}
+
+
+void DataExporter::updateNodeTreeVersions()
+{
+	// a tree keeps its version until tagged as updated, so unchanged trees keep their version between updates
+	HashMap<const void*, NodeTreeState> states;
+	for (auto & ntree : Blender::collection(m_data.node_groups)) {
+		auto oldIt = m_ntree_states.find(ntree.ptr.data);
+		const bool isNew = oldIt == m_ntree_states.end();
+
+		NodeTreeState &state = states[ntree.ptr.data];
+		if (!isNew) {
+			state = std::move(oldIt->second);
+		}
+		if (isNew || ntree.is_updated()) {
+			state.version = ++m_ntree_version_counter;
+			// group nodes can be changed only with a tree update
+			state.groups.clear();
+			for (auto node : Blender::collection(ntree.nodes)) {
+				if (node.is_a(&RNA_ShaderNodeGroup) || node.is_a(&RNA_NodeCustomGroup)) {
+					BL::NodeTree groupTree(Nodes::GetGroupNodeTree(node));
+					if (groupTree) {
+						state.groups.push_back(groupTree.ptr.data);
+					}
+				}
+			}
+		}
+		state.name = ntree.name();
+	}
+	// deleted trees are dropped
+	m_ntree_states.swap(states);
+}
+
+
+bool DataExporter::getNodeTreeVersions(const void *ntree, std::vector<std::pair<std::string, uint64_t>> &versions, int depth) const
+{
+	auto stateIt = m_ntree_states.find(ntree);
+	// Blender does not allow recursive groups, the depth is only a guard
+	if (stateIt == m_ntree_states.end() || depth > 64) {
+		return false;
+	}
+
+	versions.emplace_back(stateIt->second.name, stateIt->second.version);
+	for (const void *group : stateIt->second.groups) {
+		if (!getNodeTreeVersions(group, versions, depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
 AttrValue DataExporter::getDefaultMaterial()
 {
 	return m_defaults.override_material
@@ -83,6 +140,27 @@ AttrValue DataExporter::exportMaterial(BL::Material ma, BL::Object ob, bool expo
 		return material; // material has no NTREE - export default
 	}
 
+	// viewport updates reuse the material exported in a previous update if neither it nor its trees were updated
+	const bool useExportCache = m_exporter->get_is_viewport() && !m_is_preview && !m_exporter->getIgnorePluginExport();
+	MaterialExportKey exportKey;
+	if (useExportCache) {
+		exportKey.name = ma.name();
+		if (m_defaults.override_material.type == ValueTypePlugin) {
+			exportKey.overrideName = m_defaults.override_material.as<AttrPlugin>().plugin;
+		}
+		exportKey.asOverride = exportAsOverride;
+		const bool hasVersions = getNodeTreeVersions(ntree.ptr.data, exportKey.treeVersions);
+
+		const bool isUpdated = !hasVersions || ma.is_updated() || ma.is_updated_data();
+
+		std::lock_guard<std::mutex> mtlLock(m_materials_mtx);
+		auto iter = m_material_exports.find(ma.ptr.data);
+		if (!isUpdated && iter != m_material_exports.end() && iter->second.key == exportKey) {
+			m_exported_materials.insert(std::make_pair(ma, iter->second.material));
+			return iter->second.material;
+		}
+	}
+
 	BL::Node output(Nodes::GetNodeByType(ntree, "VRayNodeOutputMaterial"));
 	if (!output) {
 		return material; // material has ntree but it's "empty" - export default
@@ -166,6 +244,9 @@ AttrValue DataExporter::exportMaterial(BL::Material ma, BL::Object ob, bool expo
 	{
 		std::lock_guard<std::mutex> mtlLock(m_materials_mtx);
 		m_exported_materials.insert(std::make_pair(ma, material));
+		if (useExportCache) {
+			m_material_exports[ma.ptr.data] = {std::move(exportKey), material};
+		}
 	}
 
 	return material;
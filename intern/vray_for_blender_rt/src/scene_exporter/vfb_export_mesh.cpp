@@ -28,6 +28,13 @@ AttrValue DataExporter::exportGeomStaticMesh(BL::Object ob, const ObjectOverride
 
 	const std::string meshName = getMeshName(ob);
 
+	// with velocity motion blur mesh data is collected on each sample, so skip plugin cache check
+	// but still evaluate meshes used by several objects only once per sample
+	const bool velocitySample = isVelocityMotionBlurSample();
+	if (velocitySample && !beginVelocitySample(meshName)) {
+		return AttrPlugin(meshName);
+	}
+
 	PluginDesc geomDesc(meshName, "GeomStaticMesh");
 
 	Mesh::ExportOptions options;
@@ -36,6 +43,7 @@ AttrValue DataExporter::exportGeomStaticMesh(BL::Object ob, const ObjectOverride
 	options.use_subsurf_to_osd = m_settings.use_subsurf_to_osd;
 	options.force_dynamic_geometry = m_settings.is_gpu && m_settings.is_viewport ||
 	                                 oattrs && oattrs.useInstancer;
+	options.vertices_only = isVelocityPositionsSample();
 
 	const Mesh::MeshExportResult res = FillMeshData(m_data,
 	                                                m_scene,
@@ -44,11 +52,15 @@ AttrValue DataExporter::exportGeomStaticMesh(BL::Object ob, const ObjectOverride
 	                                                geomDesc,
 	                                                m_exporter->getPluginManager(),
 	                                                m_exporter->get_current_frame(),
-	                                                !isIPR && !m_exporter->getIgnorePluginExport());
+	                                                !velocitySample && !isIPR && !m_exporter->getIgnorePluginExport());
 
 	switch (res) {
 		case Mesh::MeshExportResult::exported: {
-			geom = m_exporter->export_plugin(geomDesc);
+			if (addVelocities(geomDesc, "vertices")) {
+				geom = m_exporter->export_plugin(geomDesc);
+			} else {
+				geom = AttrPlugin(meshName);
+			}
 			break;
 		}
 		case Mesh::MeshExportResult::cached: {
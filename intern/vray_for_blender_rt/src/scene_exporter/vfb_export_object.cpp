@@ -24,6 +24,10 @@
 #include "DNA_object_types.h"
 #include "vfb_utils_math.h"
 
+extern "C" {
+#include "BLI_task.h"
+}
+
 
 using namespace VRayForBlender;
 
@@ -588,27 +592,87 @@ void DataExporter::exportHair(BL::Object ob, BL::ParticleSystemModifier psm, BL:
 namespace
 {
 
-bool instancerItemCompare(const AttrInstancer::Item & left, const AttrInstancer::Item & right) {
-	return left.index < right.index;
-};
+/// Maps particle index to the position of the particle in the instancer's data
+class InstancerParticleIndex {
+public:
+	/// Indices spanning up to this many times the particle count are mapped with a flat array
+	static const int DenseRangeFactor = 4;
+
+	explicit InstancerParticleIndex(const AttrInstancer & instancer) {
+		const int count = instancer.data.getCount();
+		if (!count) {
+			return;
+		}
+		const AttrInstancer::Item *items = *instancer.data;
 
-void sortInstancerParticles(AttrInstancer & instancer) {
-	if (instancer.data.getCount()) {
-		std::sort(instancer.data.getData()->begin(), instancer.data.getData()->end(), instancerItemCompare);
+		int minIndex = items[0].index;
+		int maxIndex = items[0].index;
+		for (int c = 1; c < count; ++c) {
+			minIndex = std::min(minIndex, items[c].index);
+			maxIndex = std::max(maxIndex, items[c].index);
+		}
+
+		const int64_t range = int64_t(maxIndex) - minIndex + 1;
+		if (range <= int64_t(count) * DenseRangeFactor) {
+			m_minIndex = minIndex;
+			m_dense.resize(range, -1);
+			for (int c = 0; c < count; ++c) {
+				int & position = m_dense[items[c].index - minIndex];
+				if (position == -1) {
+					position = c;
+				}
+			}
+		} else {
+			m_sparse.reserve(count);
+			for (int c = 0; c < count; ++c) {
+				m_sparse.emplace(items[c].index, c);
+			}
+		}
 	}
-}
 
-AttrInstancer::Item * getParticle(AttrInstancer & instancer, int index) {
-	AttrInstancer::Item findItem;
-	findItem.index = index;
+	/// Get the position of the particle with @index, -1 if there is no such particle
+	int find(int index) const {
+		if (!m_dense.empty()) {
+			const int64_t offset = int64_t(index) - m_minIndex;
+			return offset >= 0 && offset < int64_t(m_dense.size()) ? m_dense[offset] : -1;
+		}
+		auto iter = m_sparse.find(index);
+		return iter != m_sparse.end() ? iter->second : -1;
+	}
+
+private:
+	int               m_minIndex = 0;
+	std::vector<int>  m_dense;  ///< Position by (index - m_minIndex) when indices are compact
+	HashMap<int, int> m_sparse; ///< Position by index otherwise
+};
+
+/// Particle count below which velocities are computed on the calling thread
+const int InstancerVelocityMinParallel = 1 << 14;
+
+/// Data for computing particle velocities between two instancer key frames
+struct InstancerVelocityTask {
+	AttrInstancer::Item          *prevItems;
+	const AttrInstancer::Item    *currentItems;
+	const InstancerParticleIndex *currentIndex;
+	float                         frameStep;
+};
 
-	auto iter = std::lower_bound(instancer.data.getData()->begin(), instancer.data.getData()->end(), findItem, instancerItemCompare);
-	if (iter != instancer.data.getData()->end()) {
-		if (iter->index == index) {
-			return &*iter;
+void ComputeInstancerVelocity(void *__restrict userdata, const int c, const ParallelRangeTLS *__restrict)
+{
+	const InstancerVelocityTask &task = *reinterpret_cast<const InstancerVelocityTask*>(userdata);
+	AttrInstancer::Item & particle = task.prevItems[c];
+
+	const int currentPosition = task.currentIndex->find(particle.index);
+	if (currentPosition != -1) {
+		// put destination on velocity
+		//particle.vel = currentFrameItem->tm - particle.tm;
+		particle.vel = task.currentItems[currentPosition].vel - particle.vel;
+		if (!Math::floatEqual(task.frameStep, 0.f)) {
+			particle.vel = particle.vel / task.frameStep;
 		}
+	} else {
+		memset(&particle.vel, 0, sizeof(particle.vel));
 	}
-	return nullptr;
 }
 
 }
@@ -619,17 +683,13 @@ AttrValue DataExporter::exportVrayInstancer2(BL::Object ob, AttrInstancer & inst
 	const auto & wrapperName = "NodeWrapper@" + exportName;
 	PluginDesc nodeWrapper(wrapperName, "Node");
 	AttrInstancer * exportData = nullptr;
+	AttrInstancer prevFrameData;
 	const float saveFrame = m_exporter->get_current_frame();
 
-	bool freeExportData = false;
 	// checkMBlur == false is passed on data flush (the last key frame)
 	if (m_settings.use_motion_blur && m_settings.calculate_instancer_velocity && checkMBlur) {
 		// if we have mblur we need to calculate velocity TM for particles
 		// so we save data for current frame and export previous calculating velocity
-
-		// sort this so we can lookup fast by instance index
-		sortInstancerParticles(instancer);
-		AttrInstancer *savedData = nullptr;
 		{
 			std::lock_guard<std::mutex> lock(m_instMtx);
 			auto iter = m_prevFrameInstancer.find(exportName);
@@ -638,39 +698,32 @@ AttrValue DataExporter::exportVrayInstancer2(BL::Object ob, AttrInstancer & inst
 				m_prevFrameInstancer.emplace(std::make_pair(exportName, InstancerData{instancer, ob, dupliType, exportObTm}));
 				return m_exporter->export_plugin(nodeWrapper, false, true);
 			}
-			savedData = &iter->second.instancer;
+			// take previous frame out of the map and put current frame in its place
+			prevFrameData = std::move(iter->second.instancer);
+			iter->second.instancer = instancer;
 		}
 
-		const float frameStep = instancer.frameNumber - savedData->frameNumber;
 		// we have data for prev frame
-		for (int c = 0; c < savedData->data.getCount(); c++) {
-			auto & particle = (*savedData->data.getData())[c];
-
-			AttrInstancer::Item * currentFrameItem = getParticle(instancer, particle.index);
-			if (currentFrameItem) {
-				// put destination on velocity
-				//particle.vel = currentFrameItem->tm - particle.tm;
-				particle.vel = currentFrameItem->vel - particle.vel;
-				if (!Math::floatEqual(frameStep, 0.f)) {
-					particle.vel = particle.vel / frameStep;
-				}
-			} else {
-				memset(&particle.vel, 0, sizeof(particle.vel));
-			}
+		const int prevCount = prevFrameData.data.getCount();
+		if (prevCount) {
+			const InstancerParticleIndex currentIndex(instancer);
+
+			InstancerVelocityTask task;
+			task.prevItems    = *prevFrameData.data;
+			task.currentItems = *instancer.data;
+			task.currentIndex = &currentIndex;
+			task.frameStep    = instancer.frameNumber - prevFrameData.frameNumber;
+
+			ParallelRangeSettings settings;
+			BLI_parallel_range_settings_defaults(&settings);
+			settings.use_threading = prevCount > InstancerVelocityMinParallel;
+			settings.min_iter_per_thread = InstancerVelocityMinParallel;
+			BLI_task_parallel_range(0, prevCount, &task, ComputeInstancerVelocity, &settings);
 		}
-		// copy container here
-		exportData = new AttrInstancer(*savedData);
+
+		exportData = &prevFrameData;
 		// we need to change this so interpolate(FRAME, DATA) writes correct frame
 		m_exporter->set_current_frame(exportData->frameNumber);
-		freeExportData = true;
-
-		// put current frame in map
-		{
-			std::lock_guard<std::mutex> lock(m_instMtx);
-			auto iter = m_prevFrameInstancer.find(exportName);
-			VFB_Assert(iter != m_prevFrameInstancer.end() && "Plugin is in m_prevFrameInstancer but not found");
-			iter->second.instancer = instancer;
-		}
 	} else {
 		exportData = &instancer;
 		for (int c = 0; c < exportData->data.getCount(); c++) {
@@ -721,9 +774,6 @@ AttrValue DataExporter::exportVrayInstancer2(BL::Object ob, AttrInstancer & inst
 
 	auto plgValue = m_exporter->export_plugin(nodeWrapper);
 	m_exporter->set_current_frame(saveFrame);
-	if (freeExportData) {
-		delete exportData;
-	}
 
 	return plgValue;
 }
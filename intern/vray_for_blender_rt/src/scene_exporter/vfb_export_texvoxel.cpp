@@ -24,8 +24,13 @@
 #include "BLI_math.h"
 #include "smoke_API.h"
 
+#include "utils/cgr_voxel.h"
+
 #define CGR_USE_SMOKE_DATA_DEBUG  0
 
+/// Voxels per side of the blocks skipped by the sparse export
+#define CGR_SPARSE_BRICK_SIZE     8
+
 using namespace VRayForBlender;
 
 #define COPY_VECTOR_3_3(a, b) \
@@ -104,6 +109,14 @@ void TexVoxelData::setInterpolation(int value)
 }
 
 
+void TexVoxelData::setSparse(bool use, float threshold, bool quantizeHalf)
+{
+	m_sparse = use;
+	m_sparseThreshold = threshold;
+	m_quantizeHalf = quantizeHalf;
+}
+
+
 void TexVoxelData::init(SmokeModifierData *smd)
 {
 	m_smd = smd;
@@ -203,17 +216,21 @@ void TexVoxelData::initSmoke() {
 	}
 	getLog().info("Density range: [%.3f-%.3f]", min_dens, max_dens);
 #endif
-	if (dens) {
-		m_dens.resize(tot_res_high);
-		std::copy(dens, dens + tot_res_high, m_dens.getData()->begin());
-	}
-	if (flame) {
-		m_flame.resize(tot_res_high);
-		std::copy(flame, flame + tot_res_high, m_flame.getData()->begin());
-	}
-	if (fuel) {
-		m_fuel.resize(tot_res_high);
-		std::copy(fuel, fuel + tot_res_high, m_fuel.getData()->begin());
+	if (m_sparse) {
+		initSparse(dens, flame, fuel);
+	} else {
+		if (dens) {
+			m_dens.resize(tot_res_high);
+			std::copy(dens, dens + tot_res_high, m_dens.getData()->begin());
+		}
+		if (flame) {
+			m_flame.resize(tot_res_high);
+			std::copy(flame, flame + tot_res_high, m_flame.getData()->begin());
+		}
+		if (fuel) {
+			m_fuel.resize(tot_res_high);
+			std::copy(fuel, fuel + tot_res_high, m_fuel.getData()->begin());
+		}
 	}
 #if CGR_USE_HEAT
 	if (heat) {
@@ -224,6 +241,46 @@ void TexVoxelData::initSmoke() {
 }
 
 
+void TexVoxelData::initSparse(float *dens, float *flame, float *fuel)
+{
+	const float *grids[] = {dens, flame, fuel};
+	AttrListFloat *lists[] = {&m_dens, &m_flame, &m_fuel};
+	const int gridCount = ArraySize(grids);
+
+	std::vector<char> activeBricks;
+	const VoxelRegion region = FindActiveVoxelBricks(grids, gridCount, m_res_high, CGR_SPARSE_BRICK_SIZE,
+	                                                 m_sparseThreshold, activeBricks);
+	const size_t regionVoxels = (size_t)region.size[0] * (size_t)region.size[1] * (size_t)region.size[2];
+
+	for (int c = 0; c < gridCount; ++c) {
+		if (grids[c]) {
+			lists[c]->resize(regionVoxels);
+			CopyVoxelBricks(lists[c]->getData()->data(), grids[c], m_res_high, region,
+			                CGR_SPARSE_BRICK_SIZE, activeBricks, m_quantizeHalf);
+		}
+	}
+
+	getLog().debug("Object: %s => exporting %dx%dx%d of %dx%dx%d voxels",
+	               m_ob->id.name + 2, region.size[0], region.size[1], region.size[2],
+	               m_res_high[0], m_res_high[1], m_res_high[2]);
+
+	// The texture maps UVW [0, 1] to the whole grid, remap it to the exported region:
+	// uvw' = (uvw * res - offset) / size
+	float regionTm[4][4];
+	unit_m4(regionTm);
+	for (int c = 0; c < 3; ++c) {
+		regionTm[c][c] = static_cast<float>(m_res_high[c]) / region.size[c];
+		regionTm[3][c] = -static_cast<float>(region.offset[c]) / region.size[c];
+	}
+
+	float uvwTm[4][4];
+	copy_m4_m4(uvwTm, m_uvw_transform);
+	mul_m4_m4m4(m_uvw_transform, regionTm, uvwTm);
+
+	COPY_VECTOR_3_3(m_res_high, region.size);
+}
+
+
 AttrValue TexVoxelData::export_plugins(PluginExporterPtr exporter)
 {
 	PluginDesc uvPlanarWorld("UVW" + m_name, "UVWGenPlanarWorld");
@@ -52,6 +52,9 @@ public:
 	TexVoxelData(Object *ob)
 	    : m_smd(nullptr)
 	    , p_interpolation(0)
+	    , m_sparse(false)
+	    , m_sparseThreshold(0.f)
+	    , m_quantizeHalf(false)
 	    , m_ob(ob)
 	{}
 
@@ -61,9 +64,16 @@ public:
 	void               init(SmokeModifierData *smd);
 	void               setInterpolation(int value);
 
+	/// Export only the bricks of voxels with a value above @threshold, cropped to their bounding box
+	/// Must be called before init()
+	/// @quantizeHalf - round values to half float precision, so they compress better
+	void               setSparse(bool use, float threshold, bool quantizeHalf);
+
 private:
 	void               initUvTransform();
 	void               initSmoke();
+	/// Copy the active bricks of the grids to the lists and remap the UVWs to the exported region
+	void               initSparse(float *dens, float *flame, float *fuel);
 
 	SmokeModifierData *m_smd;
 
@@ -81,6 +91,11 @@ private:
 
 	float              m_uvw_transform[4][4];
 	int                p_interpolation;
+
+	bool               m_sparse;
+	float              m_sparseThreshold;
+	bool               m_quantizeHalf;
+
 	Object            *m_ob;
 };
 
@@ -122,6 +122,19 @@ void IdTrack::reset_usage() {
 	}
 }
 
+void IdTrack::mark_used_except(const HashSet<const void*> &objects) {
+	for (auto &dIt : data) {
+		IdDep &dep = dIt.second;
+		if (objects.count(dep.object.ptr.data)) {
+			continue;
+		}
+		for (auto &pl : dep.plugins) {
+			pl.second.used = true;
+		}
+		dep.used = true;
+	}
+}
+
 HashSet<std::string> IdTrack::getAllObjectPlugins(BL::Object ob) const {
 	auto iter = data.find(DataExporter::getIdUniqueName(ob));
 	if (iter == data.end()) {
@@ -330,11 +343,86 @@ void DataExporter::reset()
 	m_id_cache.clear();
 	m_id_track.clear();
 	clearMaterialCache();
+	clearMaterialExportCache();
+	m_ntree_states.clear();
 	// all hidden objects will be checked agains current settings
 	refreshHideLists();
 	// layer did not change since last set
 	m_layer_changed = true;
 	m_scene_layers = to_int_layer(m_scene.layers());
+
+	std::lock_guard<std::mutex> velocityLock(m_velocityMtx);
+	m_velocitySamples.clear();
+}
+
+bool DataExporter::beginVelocitySample(const std::string &pluginName)
+{
+	const float frame = m_exporter->get_current_frame();
+
+	std::lock_guard<std::mutex> lock(m_velocityMtx);
+	auto iter = m_velocitySamples.find(pluginName);
+	if (iter == m_velocitySamples.end()) {
+		m_velocitySamples[pluginName].frame = frame;
+		return true;
+	}
+	if (iter->second.frame == frame) {
+		return false;
+	}
+	iter->second.frame = frame;
+	return true;
+}
+
+bool DataExporter::addVelocities(PluginDesc &geomDesc, const std::string &verticesAttr)
+{
+	if (!isVelocityMotionBlurSample()) {
+		return true;
+	}
+
+	const PluginAttr *attr = geomDesc.get(verticesAttr);
+	if (!attr || attr->attrValue.type != ValueTypeListVector) {
+		return true;
+	}
+	const AttrListVector &vertices = attr->attrValue.as<AttrListVector>();
+
+	std::lock_guard<std::mutex> lock(m_velocityMtx);
+	VelocitySample &sample = m_velocitySamples[geomDesc.pluginName];
+
+	if (isVelocityPositionsSample()) {
+		// lists share their data so this only keeps a reference to the vertices
+		sample.vertices = vertices;
+		return false;
+	}
+
+	const int count = vertices.getCount();
+	if (count && sample.vertices.getCount() == count && m_mbSampleStep > 0.f) {
+		const float invStep = 1.f / m_mbSampleStep;
+		// the vertices are from the last sample, V-Ray moves them by the velocities from the render frame
+		const float lastOffset = m_mbIntervalStart + (m_mbSampleCount - 1) * m_mbSampleStep;
+		const AttrVector *cur = *vertices;
+		const AttrVector *prev = *sample.vertices;
+
+		// velocities are in scene units per frame
+		AttrListVector velocities(count);
+		AttrListVector frameVertices(count);
+		AttrVector *vel = *velocities;
+		AttrVector *frameVert = *frameVertices;
+		for (int c = 0; c < count; ++c) {
+			vel[c].x = (cur[c].x - prev[c].x) * invStep;
+			vel[c].y = (cur[c].y - prev[c].y) * invStep;
+			vel[c].z = (cur[c].z - prev[c].z) * invStep;
+			frameVert[c].x = cur[c].x - vel[c].x * lastOffset;
+			frameVert[c].y = cur[c].y - vel[c].y * lastOffset;
+			frameVert[c].z = cur[c].z - vel[c].z * lastOffset;
+		}
+		geomDesc.add(verticesAttr, frameVertices);
+		geomDesc.add("velocities", velocities);
+	} else if (sample.vertices.getCount() != count && sample.vertices.getCount()) {
+		getLog().warning("Plugin \"%s\" changed topology during motion blur interval, exporting without velocities",
+		                 geomDesc.pluginName.c_str());
+	}
+
+	sample.vertices = AttrListVector();
+	return true;
 }
 
 AttrValue DataExporter::exportDefaultSocket(BL::NodeTree &ntree, BL::NodeSocket &socket)
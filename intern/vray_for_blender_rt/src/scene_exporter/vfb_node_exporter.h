@@ -30,6 +30,7 @@
 #include <stack>
 #include <vector>
 #include <deque>
+#include <limits>
 #include <mutex>
 
 #ifdef WITH_OSL
@@ -192,6 +193,9 @@ struct IdTrack {
 	void              clear();
 	void              insert(BL::Object ob, const std::string &plugin, PluginType type = PluginType::NONE);
 	void              reset_usage();
+	/// Mark all plugins of all objects except @objects (keyed by data pointer) as used,
+	/// for syncs exporting only the updated objects
+	void              mark_used_except(const HashSet<const void*> &objects);
 
 	HashSet<std::string> getAllObjectPlugins(BL::Object ob) const;
 
@@ -468,6 +472,10 @@ public:
 	static bool       isObGroupInstance(BL::Object ob);
 
 	void              clearMaterialCache();
+	/// Clear the materials kept between viewport updates, so they are exported again
+	void              clearMaterialExportCache();
+	/// Update the versions of the node trees from their update tags, must be called on each sync before exporting materials
+	void              updateNodeTreeVersions();
 
 	void              setActiveCamera(BL::Object camera);
 	void              refreshHideLists();
@@ -476,6 +484,41 @@ public:
 	/// Set IPR update state.
 	void setIsIPR(int value) { isIPR = value; }
 
+	/// Set the motion blur sample that is currently exported
+	/// @index - index of the sample in [0, count), -1 when not exporting motion blur samples
+	/// @count - number of motion blur samples for one render frame
+	/// @step - distance in frames between two samples
+	/// @intervalStart - offset in frames of the first sample from the render frame
+	void setMotionBlurSample(int index, int count, float step, float intervalStart) {
+		m_mbSampleIndex = index;
+		m_mbSampleCount = count;
+		m_mbSampleStep = step;
+		m_mbIntervalStart = intervalStart;
+	}
+
+	/// Check if deforming geometry should be exported with velocities for the current motion blur sample
+	bool isVelocityMotionBlurSample() const {
+		return m_settings.use_velocity_motion_blur && m_mbSampleIndex >= 0 && m_mbSampleCount > 1;
+	}
+
+	/// Check if only the vertex positions of deforming geometry are needed for the current motion blur sample
+	/// They are kept for the velocities, the geometry is exported on the last sample
+	bool isVelocityPositionsSample() const {
+		return isVelocityMotionBlurSample() && m_mbSampleIndex < m_mbSampleCount - 1;
+	}
+
+	/// Mark geometry plugin as handled for the current motion blur sample
+	/// @return false if the plugin was already handled on this sample (by another object using the same data)
+	bool              beginVelocitySample(const std::string &pluginName);
+
+	/// Velocity motion blur: keep the vertices of geometry on all but the last motion blur sample
+	/// and add "velocities" computed from the previous sample on the last one
+	/// The vertices are moved back by the velocities to the render frame, where V-Ray applies them
+	/// @geomDesc - the geometry plugin
+	/// @verticesAttr - name of the vertex positions list in geomDesc
+	/// @return true if geomDesc should be exported for the current sample
+	bool              addVelocities(PluginDesc &geomDesc, const std::string &verticesAttr);
+
 private:
 	/// Find the corresponding uvwgen used for the texture that might be attached to @textureSocket
 	/// @ntree - the node tree that this socket is in
@@ -585,6 +628,37 @@ private:
 	MaterialCache     m_exported_materials;
 	std::mutex        m_materials_mtx;
 
+	/// Node tree state used to tell if materials exported in previous viewport updates are still valid
+	struct NodeTreeState {
+		uint64_t                  version = 0; ///< new value from m_ntree_version_counter each time the tree is tagged as updated
+		std::string               name; ///< plugin names depend on the tree name
+		std::vector<const void*>  groups; ///< trees of the group nodes, scanned when the tree is updated
+	};
+	HashMap<const void*, NodeTreeState> m_ntree_states;
+	uint64_t          m_ntree_version_counter = 0; ///< versions are unique for all trees, so a new tree at a freed address gets a new one
+
+	/// Everything a material export depends on, compared as a whole to reuse the export
+	struct MaterialExportKey {
+		std::string  name;
+		std::string  overrideName; ///< plugin name of the override material, empty if none
+		bool         asOverride = false;
+		std::vector<std::pair<std::string, uint64_t>> treeVersions; ///< name and version of the tree and all its group trees
+
+		bool operator==(const MaterialExportKey &other) const {
+			return name == other.name && overrideName == other.overrideName && asOverride == other.asOverride && treeVersions == other.treeVersions;
+		}
+	};
+	/// Append the name and version of @ntree and its group trees to @versions
+	/// @return false if a tree is not in m_ntree_states
+	bool              getNodeTreeVersions(const void *ntree, std::vector<std::pair<std::string, uint64_t>> &versions, int depth = 0) const;
+
+	/// Material exported in a previous viewport update, valid while its key is unchanged
+	struct MaterialExport {
+		MaterialExportKey  key;
+		AttrValue          material;
+	};
+	HashMap<const void*, MaterialExport> m_material_exports;
+
 	struct InstancerData {
 		AttrInstancer instancer;
 		BL::Object ob;
@@ -595,6 +669,20 @@ private:
 	InstCache         m_prevFrameInstancer;
 	std::mutex        m_instMtx;
 
+	/// Geometry state kept between motion blur samples for velocity motion blur
+	struct VelocitySample {
+		AttrListVector vertices; ///< vertices from the previous motion blur sample, empty after the last one
+		float          frame = std::numeric_limits<float>::lowest(); ///< the frame of the sample that last handled the plugin
+	};
+	typedef HashMap<std::string, VelocitySample> VelocityCache;
+	VelocityCache     m_velocitySamples;
+	std::mutex        m_velocityMtx;
+
+	int               m_mbSampleIndex = -1;
+	int               m_mbSampleCount = 1;
+	float             m_mbSampleStep = 0.f;
+	float             m_mbIntervalStart = 0.f;
+
 	/// Flag indicating that we're inside an IPR update call.
 	int isIPR{false};
 };
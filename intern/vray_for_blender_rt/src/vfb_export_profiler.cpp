@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vfb_export_profiler.h"
+#include "vfb_log.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace VRayForBlender;
+
+namespace {
+
+/// Escape @value to be written as JSON string
+std::string jsonEscape(const std::string &value)
+{
+	std::string result;
+	result.reserve(value.size());
+	for (const char c : value) {
+		switch (c) {
+			case '"':  result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n"; break;
+			case '\t': result += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					result += buf;
+				} else {
+					result += c;
+				}
+		}
+	}
+	return result;
+}
+
+/// Escape @value to be written as CSV field
+std::string csvEscape(const std::string &value)
+{
+	if (value.find_first_of(",\"\n") == std::string::npos) {
+		return value;
+	}
+	std::string result = "\"";
+	for (const char c : value) {
+		if (c == '"') {
+			result += '"';
+		}
+		result += c;
+	}
+	return result + "\"";
+}
+
+typedef std::pair<std::string, ExportProfiler::Counters> CountersItem;
+
+/// Get counters sorted by time, most expensive first
+template <typename MapT>
+std::vector<CountersItem> sortedByTime(const MapT &map)
+{
+	std::vector<CountersItem> items(map.begin(), map.end());
+	std::sort(items.begin(), items.end(), [](const CountersItem &a, const CountersItem &b) {
+		return a.second.seconds > b.second.seconds;
+	});
+	return items;
+}
+
+}
+
+void ExportProfiler::add(Category category, const std::string &name, double seconds, uint64_t inputBytes, bool cacheHit, double waitSeconds)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Counters &counters = category == Category::PluginType ? m_pluginTypes[name] : m_objects[name];
+	counters.calls++;
+	counters.seconds += seconds;
+	counters.waitSeconds += waitSeconds;
+	counters.inputBytes += inputBytes;
+	if (cacheHit) {
+		counters.cacheHits++;
+	}
+}
+
+void ExportProfiler::reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pluginTypes.clear();
+	m_objects.clear();
+}
+
+uint64_t ExportProfiler::getValueSize(const AttrValue &value)
+{
+	uint64_t bytes = 0;
+	switch (value.type) {
+		case ValueTypeListInt:
+			bytes += value.as<AttrListInt>().getBytesCount();
+			break;
+		case ValueTypeListFloat:
+			bytes += value.as<AttrListFloat>().getBytesCount();
+			break;
+		case ValueTypeListVector:
+			bytes += value.as<AttrListVector>().getBytesCount();
+			break;
+		case ValueTypeListColor:
+			bytes += value.as<AttrListColor>().getBytesCount();
+			break;
+		case ValueTypeMapChannels:
+			for (const auto &mapIt : value.as<AttrMapChannels>().data) {
+				bytes += mapIt.second.faces.getBytesCount();
+				bytes += mapIt.second.vertices.getBytesCount();
+			}
+			break;
+		default:
+			break;
+	}
+	return bytes;
+}
+
+uint64_t ExportProfiler::getDataSize(const PluginDesc &pluginDesc)
+{
+	uint64_t bytes = 0;
+	for (const auto &attrIt : pluginDesc.pluginAttrs) {
+		bytes += getValueSize(attrIt.second.attrValue);
+	}
+	return bytes;
+}
+
+bool ExportProfiler::writeReport(const std::string &filePath) const
+{
+	std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+	if (!file) {
+		getLog().error("Failed to open export profiler report file \"%s\"", filePath.c_str());
+		return false;
+	}
+
+	const std::string ext = boost::algorithm::to_lower_copy(boost::filesystem::path(filePath).extension().string());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const Category categories[] = {Category::PluginType, Category::Object};
+
+	if (ext == ".csv") {
+		file << "category,name,calls,cache_hits,input_bytes,seconds,wait_seconds\n";
+		for (const Category category : categories) {
+			const char *categoryName = category == Category::PluginType ? "plugin" : "object";
+			for (const auto &item : sortedByTime(getCounters(category))) {
+				const Counters &counters = item.second;
+				file << categoryName << ',' << csvEscape(item.first) << ','
+				     << counters.calls << ',' << counters.cacheHits << ','
+				     << counters.inputBytes << ',' << counters.seconds << ',' << counters.waitSeconds << '\n';
+			}
+		}
+	} else {
+		file << "{\n";
+		for (const Category category : categories) {
+			file << (category == Category::PluginType ? "\t\"plugins\": [" : ",\n\t\"objects\": [");
+			bool first = true;
+			for (const auto &item : sortedByTime(getCounters(category))) {
+				const Counters &counters = item.second;
+				file << (first ? "\n" : ",\n")
+				     << "\t\t{\"name\": \"" << jsonEscape(item.first) << "\""
+				     << ", \"calls\": " << counters.calls
+				     << ", \"cache_hits\": " << counters.cacheHits
+				     << ", \"input_bytes\": " << counters.inputBytes
+				     << ", \"seconds\": " << counters.seconds
+				     << ", \"wait_seconds\": " << counters.waitSeconds << "}";
+				first = false;
+			}
+			file << "\n\t]";
+		}
+		file << "\n}\n";
+	}
+
+	if (!file) {
+		getLog().error("Failed to write export profiler report file \"%s\"", filePath.c_str());
+		return false;
+	}
+
+	getLog().info("Export profiler report written to \"%s\"", filePath.c_str());
+	return true;
+}
+
+void ExportProfiler::logSummary(int count) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const auto plugins = sortedByTime(m_pluginTypes);
+	getLog().info("Export profiler: %d plugin types", static_cast<int>(plugins.size()));
+	for (int c = 0; c < std::min(count, static_cast<int>(plugins.size())); ++c) {
+		const Counters &counters = plugins[c].second;
+		getLog().info("  %s: %.3fs, lock wait %.3fs, calls %llu, cache hits %llu, %.2f MB input",
+		              plugins[c].first.c_str(), counters.seconds, counters.waitSeconds,
+		              static_cast<unsigned long long>(counters.calls), static_cast<unsigned long long>(counters.cacheHits),
+		              counters.inputBytes / (1024.0 * 1024.0));
+	}
+
+	const auto objects = sortedByTime(m_objects);
+	getLog().info("Export profiler: %d objects", static_cast<int>(objects.size()));
+	for (int c = 0; c < std::min(count, static_cast<int>(objects.size())); ++c) {
+		getLog().info("  %s: %.3fs, calls %llu", objects[c].first.c_str(), objects[c].second.seconds,
+		              static_cast<unsigned long long>(objects[c].second.calls));
+	}
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015, Chaos Software Ltd
+ *
+ * V-Ray For Blender
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VRAY_FOR_BLENDER_EXPORT_PROFILER_H
+#define VRAY_FOR_BLENDER_EXPORT_PROFILER_H
+
+#include "vfb_typedefs.h"
+#include "vfb_plugin_attrs.h"
+
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace VRayForBlender {
+
+/// Collects wall time, call counts, exported data size and cache hits of the export
+/// per plugin type and per object. Disabled profiler only checks a flag on each call.
+class ExportProfiler {
+public:
+	/// Counters for one plugin type or object
+	struct Counters {
+		uint64_t calls; ///< Number of times export was called
+		uint64_t cacheHits; ///< Number of calls where the cached data was unchanged and nothing was exported
+		uint64_t inputBytes; ///< Size of the list data passed to the exporter, not the size written by it
+		double   seconds; ///< Total wall time, without waitSeconds
+		double   waitSeconds; ///< Time spent waiting for the export lock
+
+		Counters(): calls(0), cacheHits(0), inputBytes(0), seconds(0.0), waitSeconds(0.0) {}
+	};
+
+	/// What the measured time is accounted to
+	enum class Category {
+		PluginType,
+		Object,
+	};
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	/// Measure time from construction to destruction and add it to the profiler
+	class ScopedTimer {
+	public:
+		ScopedTimer(ExportProfiler &profiler, Category category, const std::string &name)
+			: m_profiler(profiler.isEnabled() ? &profiler : nullptr)
+			, m_category(category)
+			, m_name(m_profiler ? name : std::string())
+			, m_start(m_profiler ? Clock::now() : Clock::time_point())
+		{}
+
+		~ScopedTimer() {
+			if (m_profiler) {
+				m_profiler->add(m_category, m_name, std::chrono::duration<double>(Clock::now() - m_start).count(), 0, false);
+			}
+		}
+	private:
+		ExportProfiler      *m_profiler; ///< Null if profiler was disabled at construction
+		Category             m_category; ///< Where to add the time
+		std::string          m_name; ///< Plugin type or object name
+		Clock::time_point    m_start; ///< Construction time
+
+		VFB_DISABLE_COPY(ScopedTimer);
+	};
+
+	ExportProfiler(): m_enabled(false) {}
+
+	void setEnabled(bool enabled) { m_enabled = enabled; }
+	bool isEnabled() const { return m_enabled; }
+
+	/// Add one call to the counters
+	/// @category - account to plugin type or object
+	/// @name - the plugin type or the object name
+	/// @seconds - wall time of the call, without @waitSeconds
+	/// @inputBytes - size of the list data passed to the exporter
+	/// @cacheHit - true if nothing was exported because data was not changed
+	/// @waitSeconds - time the call waited for locks held by other exports
+	void add(Category category, const std::string &name, double seconds, uint64_t inputBytes, bool cacheHit, double waitSeconds = 0.0);
+
+	/// Write the report to @filePath, CSV if the file extension is .csv, JSON otherwise
+	/// @return - true on success
+	bool writeReport(const std::string &filePath) const;
+
+	/// Log the most expensive plugin types and objects
+	/// @count - max number of entries to log for each category
+	void logSummary(int count) const;
+
+	/// Clear all counters
+	void reset();
+
+	/// Get the size of the data of a list attribute value, 0 for other types
+	static uint64_t getValueSize(const AttrValue &value);
+
+	/// Get the size of the data in all list attributes of a plugin
+	static uint64_t getDataSize(const PluginDesc &pluginDesc);
+private:
+	typedef HashMap<std::string, Counters> CountersMap;
+
+	/// Get the counters for a category
+	const CountersMap & getCounters(Category category) const {
+		return category == Category::PluginType ? m_pluginTypes : m_objects;
+	}
+
+	bool                 m_enabled; ///< If false nothing is recorded
+	mutable std::mutex   m_mutex; ///< Protects the counter maps
+	CountersMap          m_pluginTypes; ///< Counters per plugin type
+	CountersMap          m_objects; ///< Counters per object
+
+	VFB_DISABLE_COPY(ExportProfiler);
+};
+
+} // namespace VRayForBlender
+
+#endif // VRAY_FOR_BLENDER_EXPORT_PROFILER_H
@@ -36,6 +36,7 @@
 #include <boost/lexical_cast/try_lexical_convert.hpp>
 
 #include <exception>
+#include <algorithm>
 
 namespace fs = boost::filesystem;
 using namespace VRayForBlender;
@@ -44,6 +45,14 @@ std::string VRaySettingsExporter::pythonPreviewDir;
 
 ExporterSettings::ExporterSettings()
     : export_meshes(true)
+    , export_threads(0)
+    , export_zip_level(1)
+    , use_pipelined_export(false)
+    , export_pipeline_memory(0)
+    , use_export_profiler(false)
+    , use_velocity_motion_blur(false)
+    , use_viewport_adaptive(false)
+    , viewport_target_fps(10)
     , override_material(PointerRNA_NULL)
     , current_bake_object(PointerRNA_NULL)
     , camera_stereo_left(PointerRNA_NULL)
@@ -125,6 +134,13 @@ void ExporterSettings::update(BL::Context context, BL::RenderEngine engine, BL::
 	default_mapping     = (DefaultMapping)RNA_enum_ext_get(&m_vrayExporter, "default_mapping");
 	export_meshes       = is_preview ? true : RNA_boolean_get(&m_vrayExporter, "auto_meshes");
 	export_file_format  = (ExportFormat)RNA_enum_ext_get(&m_vrayExporter, "data_format");
+	// the add-on may not define the newer options yet, use their defaults then
+	export_threads      = get<int>(m_vrayExporter, "export_threads", 0);
+	export_zip_level    = std::max(0, std::min(9, get<int>(m_vrayExporter, "data_compression_level", 1)));
+	use_pipelined_export   = get<bool>(m_vrayExporter, "export_pipelined", false);
+	export_pipeline_memory = static_cast<size_t>(std::max(0, get<int>(m_vrayExporter, "export_pipeline_memory", 0))) << 20;
+	use_export_profiler = get<bool>(m_vrayExporter, "export_profiler", false);
+	export_profiler_path = String::AbsFilePath(get<std::string>(m_vrayExporter, "export_profiler_path", std::string()), data.filepath());
 	if (is_preview) {
 		// force zip for preview so it can be faster if we are writing to file
 		export_file_format = ExportFormat::ExportFormatZIP;
@@ -262,6 +278,8 @@ void ExporterSettings::update(BL::Context context, BL::RenderEngine engine, BL::
 
 	// disable motion blur for bake render
 	use_motion_blur = use_motion_blur && !use_bake_view && !is_preview;
+	// velocities need at least two samples to be computed from
+	use_velocity_motion_blur = use_motion_blur && mb_samples > 1 && get<bool>(m_vrayExporter, "motion_blur_velocity", false);
 
 	std::string overrideName;
 	PointerRNA settingsOptions = RNA_pointer_get(&m_vrayScene, "SettingsOptions");
@@ -309,6 +327,8 @@ void ExporterSettings::update(BL::Context context, BL::RenderEngine engine, BL::
 	} else {
 		viewport_image_type = ImageType::RGBA_REAL;
 	}
+	use_viewport_adaptive = is_viewport && get<bool>(m_vrayExporter, "viewport_adaptive", false);
+	viewport_target_fps = std::max(1, get<int>(m_vrayExporter, "viewport_target_fps", 10));
 	show_vfb = !is_viewport && work_mode != WorkMode::WorkModeExportOnly && !is_preview && RNA_boolean_get(&m_vrayExporter, "display");
 	close_on_stop = RNA_boolean_get(&m_vrayExporter, "autoclose");
 
@@ -484,84 +504,6 @@ void VRaySettingsExporter::exportDelayedPlugins() {
 }
 
 
-struct PropNotFound
-	: std::runtime_error
-{
-	PropNotFound(const char * const prop)
-		: std::runtime_error(prop)
-	{}
-};
-
-/// Generic get for some type of property from RNA pointer
-/// If the the type is wrong it will just the property value's memory as the requested type
-/// @throw - PropNotFound if the property does not exist
-template <typename T>
-T get(PointerRNA &ptr, const char *name)
-{
-	// static_assert(false, "Not implemented type for get<T>(PointerRNA&, const char *)");
-	return T();
-}
-
-template <>
-bool get(PointerRNA &ptr, const char *name)
-{
-	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
-	if (prop) {
-		return RNA_property_boolean_get(&ptr, prop);
-	}
-	throw PropNotFound(name);
-}
-
-template <>
-int get(PointerRNA &ptr, const char *name)
-{
-	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
-	if (prop) {
-		return RNA_property_int_get(&ptr, prop);
-	}
-	throw PropNotFound(name);
-}
-
-template <>
-float get(PointerRNA &ptr, const char *name)
-{
-	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
-	if (prop) {
-		return RNA_property_float_get(&ptr, prop);
-	}
-	throw PropNotFound(name);
-}
-
-template <>
-PointerRNA get(PointerRNA &ptr, const char *name)
-{
-	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
-	if (prop) {
-		return RNA_property_pointer_get(&ptr, prop);
-	}
-	throw PropNotFound(name);
-}
-
-template <>
-std::string get(PointerRNA &ptr, const char *name)
-{
-	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
-	if (prop) {
-		std::string result;
-		result = "";
-		result.resize(RNA_property_string_length(&ptr, prop));
-		RNA_property_string_get(&ptr, prop, &result[0]);
-		return result;
-	}
-	throw PropNotFound(name);
-}
-
-template <typename T>
-T get(PointerRNA &ptr, const std::string & name)
-{
-	return get<T>(ptr, name.c_str());
-}
-
 bool VRaySettingsExporter::checkPluginOverrides(const std::string &pluginId, PointerRNA &propertyGroup, PluginDesc &pluginDesc)
 {
 	propertyGroup = get<PointerRNA>(vrayScene, pluginId);
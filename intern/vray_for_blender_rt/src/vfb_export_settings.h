@@ -124,7 +124,8 @@ struct ExporterSettings {
 	enum ExportFormat {
 		ExportFormatZIP = 0,
 		ExportFormatHEX,
-		ExportFormatASCII
+		ExportFormatASCII,
+		ExportFormatBIN, ///< Big lists are written in binary side-car file, small as HEX
 	};
 
 	enum WorkMode {
@@ -206,13 +207,31 @@ struct ExporterSettings {
 
 	bool              calculate_instancer_velocity;
 
+	int               export_threads; ///< Number of threads used for export, 0 means one per core
+	int               export_zip_level; ///< zlib compression level (0-9) of list data for ZIP format
+
+	/// Write the data of an animation frame while the next frame is exported, instead of waiting for it after each frame
+	bool              use_pipelined_export;
+	size_t            export_pipeline_memory; ///< Max size in bytes of list data waiting to be written with use_pipelined_export
+
+	bool              use_export_profiler; ///< Collect export time and data size per plugin type and object
+	std::string       export_profiler_path; ///< Report file of the export profiler (.json or .csv), empty for log only
+
 	int               mb_samples;
 	float             mb_duration;
 	float             mb_offset;
 
+	/// Export deforming geometry once per render frame with per-vertex velocities
+	/// instead of a geometry key for each motion blur sample
+	bool              use_velocity_motion_blur;
+
 	VRayVerboseLevel  verbose_level;
 	ImageType         viewport_image_type;
 	int               viewport_image_quality;
+	/// Lower the viewport image format and resolution while the view changes
+	/// so a new image is shown within 1 / viewport_target_fps seconds
+	bool              use_viewport_adaptive;
+	int               viewport_target_fps;
 	int               zmq_server_port;
 	std::string       zmq_server_address;
 
@@ -243,6 +243,11 @@ AttrPlugin DataExporter::exportSettingsMotionBlur(ViewParams &viewParams)
 		}
 	}
 
+	if (m_settings.use_velocity_motion_blur) {
+		// deforming geometry has one key per frame and is moved by its exported velocities
+		moBlurDesc.add("geom_samples", 1);
+	}
+
 	return m_exporter->export_plugin(moBlurDesc);
 }
 
@@ -563,7 +568,8 @@ ViewParams SceneExporter::get_current_view_params()
 	if (m_view3d) {
 		get_view_from_viewport(viewParams);
 
-		const float viewportScale = m_settings.getViewportResolutionPercentage();
+		const float viewportScale = m_settings.getViewportResolutionPercentage() * m_exporter->get_viewport_scale();
+		viewParams.viewport_scale = viewportScale;
 
 		viewParams.renderSize.w *= viewportScale;
 		viewParams.renderSize.h *= viewportScale;
@@ -108,6 +108,7 @@ struct ViewParams {
 	    , viewport_h(0)
 	    , viewport_offs_x(0)
 	    , viewport_offs_y(0)
+	    , viewport_scale(1.f)
 	{}
 
 	int changedParams(const ViewParams &other) const {
@@ -144,6 +145,7 @@ struct ViewParams {
 	int               viewport_h;
 	int               viewport_offs_x;
 	int               viewport_offs_y;
+	float             viewport_scale; ///< Render size to viewport size ratio
 };
 
 } // namespace VRayForBlender
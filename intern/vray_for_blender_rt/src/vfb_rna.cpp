@@ -45,6 +45,60 @@ std::string VRayForBlender::RNA_std_string_get(PointerRNA *ptr, const std::strin
 	return std::string(buf);
 }
 
+template <>
+bool VRayForBlender::get(PointerRNA &ptr, const char *name)
+{
+	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
+	if (prop) {
+		return RNA_property_boolean_get(&ptr, prop);
+	}
+	throw PropNotFound(name);
+}
+
+template <>
+int VRayForBlender::get(PointerRNA &ptr, const char *name)
+{
+	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
+	if (prop) {
+		return RNA_property_int_get(&ptr, prop);
+	}
+	throw PropNotFound(name);
+}
+
+template <>
+float VRayForBlender::get(PointerRNA &ptr, const char *name)
+{
+	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
+	if (prop) {
+		return RNA_property_float_get(&ptr, prop);
+	}
+	throw PropNotFound(name);
+}
+
+template <>
+PointerRNA VRayForBlender::get(PointerRNA &ptr, const char *name)
+{
+	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
+	if (prop) {
+		return RNA_property_pointer_get(&ptr, prop);
+	}
+	throw PropNotFound(name);
+}
+
+template <>
+std::string VRayForBlender::get(PointerRNA &ptr, const char *name)
+{
+	PropertyRNA *prop = RNA_struct_find_property(&ptr, name);
+	if (prop) {
+		std::string result;
+		result = "";
+		result.resize(RNA_property_string_length(&ptr, prop));
+		RNA_property_string_get(&ptr, prop, &result[0]);
+		return result;
+	}
+	throw PropNotFound(name);
+}
+
 const EnumPropertyItem *VRayForBlender::RNA_enum_item(PointerRNA *ptr, const char *attrName)
 {
 	const EnumPropertyRNA *enumProp =
@@ -24,6 +24,8 @@
 #include "RNA_access.h"
 #include "RNA_blender_cpp.h"
 
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace VRayForBlender {
@@ -56,6 +58,44 @@ std::string  RNA_enum_name_get(PointerRNA *ptr, const char *attrName);
 
 const EnumPropertyItem *RNA_enum_item(PointerRNA *ptr, const char *attrName);
 
+struct PropNotFound
+	: std::runtime_error
+{
+	PropNotFound(const char * const prop)
+		: std::runtime_error(prop)
+	{}
+};
+
+/// Generic get for some type of property from RNA pointer
+/// Implemented for bool, int, float, std::string and PointerRNA
+/// @throw - PropNotFound if the property does not exist
+template <typename T>
+T get(PointerRNA &ptr, const char *name);
+
+template <> bool        get(PointerRNA &ptr, const char *name);
+template <> int         get(PointerRNA &ptr, const char *name);
+template <> float       get(PointerRNA &ptr, const char *name);
+template <> PointerRNA  get(PointerRNA &ptr, const char *name);
+template <> std::string get(PointerRNA &ptr, const char *name);
+
+template <typename T>
+T get(PointerRNA &ptr, const std::string & name)
+{
+	return get<T>(ptr, name.c_str());
+}
+
+/// Same as get<T>(ptr, name) but returns @fallback if the property does not exist
+/// Used for properties the add-on may not define yet
+template <typename T>
+T get(PointerRNA &ptr, const char *name, const T &fallback)
+{
+	try {
+		return get<T>(ptr, name);
+	} catch (PropNotFound &) {
+		return fallback;
+	}
+}
+
 } // namespace VRayForBlender
 
 #endif // VRAY_FOR_BLENDER_RNA_H
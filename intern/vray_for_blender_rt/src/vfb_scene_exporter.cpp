@@ -30,6 +30,8 @@
 #include "DNA_ID.h"
 #include "DNA_object_types.h"
 #include "DNA_modifier_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_particle_types.h"
 
 #include "RE_engine.h"
 
@@ -214,11 +216,13 @@ void FrameExportManager::forEachExportFrame(const std::function<bool(FrameExport
 
 		for (int c = 0; c < m_mbGeomSamples; c++) {
 			m_currentFrame = m_frameToRender + m_mbIntervalStartOffset + c * m_mbSampleStep;
+			m_mbSampleIndex = c;
 			if (!callback(*this)) {
 				break;
 			}
 			m_lastExportedFrame = m_currentFrame;
 		}
+		m_mbSampleIndex = -1;
 
 		const float firstFrame = m_frameToRender + m_mbIntervalStartOffset;
 		const float lastFrame = m_frameToRender + m_mbIntervalStartOffset + (m_mbGeomSamples - 1) * m_mbSampleStep;
@@ -284,6 +288,61 @@ MHash getParticleID(BL::Object arrayGenerator, int arrayIndex)
 	MurmurHash3_x86_32(data, sizeof(data), particleID, &particleID);
 	return particleID;
 }
+
+/// Rough estimate of the work needed to export an object, used to start heavy objects first
+/// Only reads sizes from DNA, evaluated data (modifiers, children) is not known yet
+ThreadManager::Cost getObjectExportCost(BL::Object ob, bool isViewport)
+{
+	ThreadManager::Cost cost = 1;
+
+	if (ob.type() == BL::Object::type_MESH && ob.data()) {
+		const Mesh *mesh = reinterpret_cast<const Mesh*>(ob.data().ptr.data);
+		cost += mesh->totvert + mesh->totpoly;
+	}
+
+	if (ob.is_duplicator()) {
+		// each instance requires sync of the instanced object
+		cost *= 2;
+	}
+
+	for (auto & mod : Blender::collection(ob.modifiers)) {
+		if (mod.type() == BL::Modifier::type_PARTICLE_SYSTEM) {
+			BL::ParticleSystem psys = BL::ParticleSystemModifier(mod).particle_system();
+			const ParticleSystem *particleSystem = reinterpret_cast<const ParticleSystem*>(psys.ptr.data);
+			if (particleSystem && particleSystem->part) {
+				const ThreadManager::Cost strands = particleSystem->totpart + particleSystem->totchild;
+				const int steps = isViewport ? particleSystem->part->draw_step : particleSystem->part->ren_step;
+				// hair is exported point by point for each strand segment
+				cost += strands * (1 << std::max(0, steps));
+			}
+		}
+	}
+
+	return cost;
+}
+
+/// Check if an object of @group is tagged as updated, with the same checks as Blender::getObjectUpdateState
+/// Group objects need not be linked in the scene, so their tags are not seen when checking the scene objects
+/// @checkedGroups - result for groups already checked in this update
+bool isGroupUpdated(BL::Group group, HashMap<DependencyIndex::IdKey, bool> &checkedGroups)
+{
+	const DependencyIndex::IdKey groupKey = DependencyIndex::key(group);
+	const auto checkedIt = checkedGroups.find(groupKey);
+	if (checkedIt != checkedGroups.end()) {
+		return checkedIt->second;
+	}
+
+	bool updated = false;
+	for (auto groupOb : Blender::collection(group.objects)) {
+		// also checks the groups instanced by group objects
+		if (Blender::getObjectUpdateState(groupOb) != Blender::ObjectUpdateFlag::None) {
+			updated = true;
+			break;
+		}
+	}
+	checkedGroups[groupKey] = updated;
+	return updated;
+}
 }
 
 
@@ -312,6 +371,7 @@ void SceneExporter::pause_for_undo()
 	m_region = PointerRNA_NULL;
 
 	m_exporter->set_callback_on_message_updated([](const char *, const char *) {});
+	m_dependencyIndex.clear();
 }
 
 void SceneExporter::resume_from_undo(BL::Context         context,
@@ -368,7 +428,7 @@ void SceneExporter::init() {
 #if USE_MT_EXPORTER
 		// lets init ThreadManager based on object count
 		if (m_scene.objects.length() > 10) { // TODO: change to appropriate number
-			m_threadManager = ThreadManager::make(2);
+			m_threadManager = ThreadManager::make(ThreadManager::threadCountFor(m_settings.export_threads));
 		} else {
 			// thread manager with 0 means all objects will be exported from current thread
 			m_threadManager = ThreadManager::make(0);
@@ -461,6 +521,9 @@ void SceneExporter::sync(const bool check_updated)
 {
 	SCOPED_TRACE_EX("SceneExporter::sync(%d)", static_cast<int>(check_updated));
 
+	ExportProfiler &profiler = m_exporter->getProfiler();
+	profiler.setEnabled(m_settings.use_export_profiler);
+
 	if (!m_frameExporter.isCurrentSubframe()) {
 		m_data_exporter.syncStart(m_isUndoSync);
 	}
@@ -481,6 +544,10 @@ void SceneExporter::sync(const bool check_updated)
 		sync_render_channels();
 	}
 
+	if (!check_updated) {
+		// full syncs export all frame dependent values again
+		m_data_exporter.clearMaterialExportCache();
+	}
 	m_data_exporter.exportMaterialSettings();
 
 	// First materials sync is done from "sync_objects"
@@ -509,6 +576,14 @@ void SceneExporter::sync(const bool check_updated)
 	if (!m_frameExporter.isCurrentSubframe())
 		m_data_exporter.syncEnd();
 
+	if (profiler.isEnabled() && !m_frameExporter.isCurrentSubframe()) {
+		// counters are cumulative so the report covers all frames / updates exported so far
+		profiler.logSummary(10);
+		if (!m_settings.export_profiler_path.empty()) {
+			profiler.writeReport(m_settings.export_profiler_path);
+		}
+	}
+
 	m_isUndoSync = false;
 }
 
@@ -521,14 +596,64 @@ static void TagNtreeIfIdPropTextureUpdated(BL::NodeTree ntree, BL::Node node, co
 		              tex.name().c_str());
 		DataExporter::tag_ntree(ntree);
 	}
+	else if (tex && tex.type() == BL::Texture::type_IMAGE) {
+		// an image reload or source change tags only the image
+		BL::Image image(BL::ImageTexture(tex).image());
+		if (image && (image.is_updated() || image.is_updated_data())) {
+			getLog().info("Image %s is updated...",
+			              image.name().c_str());
+			DataExporter::tag_ntree(ntree);
+		}
+	}
+}
+
+
+static void TagNtreeIfObjectUpdated(BL::NodeTree ntree, const HashSet<std::string> &updatedObjects, const std::string &obName)
+{
+	if (!obName.empty() && updatedObjects.count(obName)) {
+		getLog().info("Object %s used by node tree %s is updated...",
+		              obName.c_str(), ntree.name().c_str());
+		DataExporter::tag_ntree(ntree);
+	}
+}
+
+
+static void TagNtreeIfGroupUpdated(BL::NodeTree ntree, BL::BlendData data, const HashSet<std::string> &updatedObjects, const std::string &groupName)
+{
+	if (groupName.empty() || updatedObjects.empty()) {
+		return;
+	}
+	for (auto & group : Blender::collection(data.groups)) {
+		if (group.name() == groupName) {
+			for (auto & ob : Blender::collection(group.objects)) {
+				if (updatedObjects.count(ob.name())) {
+					TagNtreeIfObjectUpdated(ntree, updatedObjects, ob.name());
+					return;
+				}
+			}
+			return;
+		}
+	}
 }
 
 
 void SceneExporter::sync_prepass()
 {
 	m_data_exporter.setActiveCamera(m_active_camera);
+	m_data_exporter.setMotionBlurSample(m_frameExporter.getMotionBlurSampleIndex(),
+	                                    m_frameExporter.getMotionBlurSamples(),
+	                                    m_frameExporter.getMotionBlurSampleStep(),
+	                                    m_frameExporter.getMotionBlurIntervalStart());
 	m_data_exporter.resetSyncState();
 
+	// node trees reference objects by name, the trees are not tagged when the objects change
+	HashSet<std::string> updatedObjects;
+	for (auto & ob : Blender::collection(m_data.objects)) {
+		if (ob.is_updated() || ob.is_updated_data()) {
+			updatedObjects.insert(ob.name());
+		}
+	}
+
 	BL::BlendData::node_groups_iterator nIt;
 	for (m_data.node_groups.begin(nIt); nIt != m_data.node_groups.end(); ++nIt) {
 		BL::NodeTree ntree(*nIt);
@@ -556,10 +681,23 @@ void SceneExporter::sync_prepass()
 						TagNtreeIfIdPropTextureUpdated(ntree, node, "ramp_grad_rad");
 						TagNtreeIfIdPropTextureUpdated(ntree, node, "ramp_frame");
 					}
+					else if (node.bl_idname() == "VRayNodeSelectObject") {
+						TagNtreeIfObjectUpdated(ntree, updatedObjects, RNA_std_string_get(&node.ptr, "objectName"));
+					}
+					else if (node.bl_idname() == "VRayNodeSelectGroup") {
+						TagNtreeIfGroupUpdated(ntree, m_data, updatedObjects, RNA_std_string_get(&node.ptr, "groupName"));
+					}
+					else if (node.bl_idname() == "VRayNodeSphereFadeGizmo") {
+						PointerRNA sphereFadeGizmo = RNA_pointer_get(&node.ptr, "SphereFadeGizmo");
+						TagNtreeIfObjectUpdated(ntree, updatedObjects, RNA_std_string_get(&sphereFadeGizmo, "object"));
+					}
 				}
 			}
 		}
 	}
+
+	// after tagging the trees using updated textures, images and objects
+	m_data_exporter.updateNodeTreeVersions();
 }
 
 void SceneExporter::sync_object_modiefiers(BL::Object ob, const int &check_updated)
@@ -1192,6 +1330,7 @@ void SceneExporter::pre_sync_object(const bool check_updated, BL::Object &ob, Co
 
 		const auto obName = ob.name();
 		SCOPED_TRACE_EX("Export task for object (%s)", obName.c_str());
+		ExportProfiler::ScopedTimer profileObject(m_exporter->getProfiler(), ExportProfiler::Category::Object, obName);
 
 		using namespace Blender;
 		const ObjectUpdateFlag flags = getObjectUpdateState(ob);
@@ -1248,15 +1387,132 @@ void SceneExporter::pre_sync_object(const bool check_updated, BL::Object &ob, Co
 		}
 
 		if (ob.select()) {
+			auto lock = m_data_exporter.raiiLock();
 			m_selectedObjects.push_back(ob);
 		}
-	}, ThreadManager::Priority::LOW);
+	}, ThreadManager::Priority::LOW, m_threadManager->workerCount() ? getObjectExportCost(ob, is_viewport()) : 0);
 }
 
+bool SceneExporter::is_object_exported(BL::Object ob)
+{
+	return m_data_exporter.isObjectVisible(ob) && !m_data_exporter.isObjectInHideList(ob, "export");
+}
+
+
+bool SceneExporter::collect_updated_objects(DependencyIndex::Dependents &updated, DependencyIndex::Dependents &forced)
+{
+	// ID pointers change on undo
+	if (m_dependencyIndex.empty() || m_isUndoSync || m_data_exporter.hasLayerChanged()) {
+		return false;
+	}
+
+	HashSet<DependencyIndex::IdKey> updatedData;
+	HashMap<DependencyIndex::IdKey, bool> checkedGroups;
+	int objectCount = 0;
+	for (auto & ob : Blender::collection(m_scene.objects)) {
+		++objectCount;
+		const DependencyIndex::ObjectState *state = m_dependencyIndex.getObject(ob);
+		if (!state || state->name != ob.name()) {
+			return false;
+		}
+
+		PointerRNA vrayObject = RNA_pointer_get(&ob.ptr, "vray");
+		const int dataUpdated = RNA_int_get(&vrayObject, "data_updated");
+		const bool dataTagged = ob.is_updated_data() || (dataUpdated & CGR_UPDATED_DATA);
+		const bool tagged = dataTagged || ob.is_updated() || (dataUpdated & CGR_UPDATED_OBJECT);
+
+		// objects hidden or shown are not tagged, group instancers are not tagged for updates of the group objects
+		BL::Group dupliGroup(ob.dupli_group());
+		if (tagged || state->visible != is_object_exported(ob) || (dupliGroup && isGroupUpdated(dupliGroup, checkedGroups))) {
+			updated.objectKeys.insert(DependencyIndex::key(ob));
+			updated.objects.push_back(ob);
+		}
+		if (dataTagged) {
+			// other objects using the same data
+			if (BL::ID data = ob.data()) {
+				updatedData.insert(DependencyIndex::key(data));
+			}
+		}
+	}
+	if (objectCount != m_dependencyIndex.objectCount()) {
+		return false;
+	}
+
+	for (auto & ntree : Blender::collection(m_data.node_groups)) {
+		if (ntree.is_updated()) {
+			m_dependencyIndex.addNodeTree(ntree);
+			updatedData.insert(DependencyIndex::key(ntree));
+		}
+	}
+
+	const HashSet<DependencyIndex::IdKey> taggedObjects(updated.objectKeys);
+	m_dependencyIndex.getObjectDependents(taggedObjects, updated);
+
+	forced.objectKeys = updated.objectKeys;
+	m_dependencyIndex.getDataDependents(updatedData, forced);
+	return true;
+}
+
+
 void SceneExporter::sync_objects(const bool check_updated) {
 	getLog().info("SceneExporter::sync_objects(%i)", check_updated);
 
-	if (!m_frameExporter.isCurrentSubframe()) {
+	DependencyIndex::Dependents updated, forced;
+	if (!m_frameExporter.isCurrentSubframe() && check_updated && collect_updated_objects(updated, forced)) {
+		getLog().info("Exporting %d updated and %d dependent objects", static_cast<int>(updated.objects.size()), static_cast<int>(forced.objects.size()));
+
+		{
+			// plugins of objects that are not exported are still used
+			auto lock = m_data_exporter.raiiLock();
+			m_data_exporter.m_id_track.mark_used_except(forced.objectKeys);
+		}
+
+		// materials using an updated node group, the updated materials are exported in sync_materials
+		if (!forced.materialKeys.empty()) {
+			for (auto & ma : Blender::collection(m_data.materials)) {
+				BL::NodeTree ntree(Nodes::GetNodeTree(ma));
+				if (ntree && forced.materialKeys.count(DependencyIndex::key(ma)) &&
+				    !(ma.is_updated() || ma.is_updated_data() || ntree.is_updated())) {
+					m_data_exporter.exportMaterial(ma, PointerRNA_NULL);
+				}
+			}
+		}
+
+		ObList objects(std::move(updated.objects));
+		objects.insert(objects.end(), forced.objects.begin(), forced.objects.end());
+		if (m_settings.use_motion_blur) {
+			// objects with subframes are exported with them
+			for (int c = objects.size() - 1; c >= 0; --c) {
+				if (m_frameExporter.hasObjectSubframes(objects[c])) {
+					objects.erase(objects.begin() + c);
+				}
+			}
+		}
+
+		CondWaitGroup wg(objects.size());
+		for (int c = 0; c < objects.size(); ++c) {
+			// objects using updated data are not tagged, so export them without checking
+			const bool checkObjectUpdated = updated.objectKeys.count(DependencyIndex::key(objects[c]));
+			pre_sync_object(checkObjectUpdated, objects[c], wg);
+		}
+
+		if (!is_interrupted() && m_threadManager->workerCount()) {
+			getLog().info("Started export for updated objects - waiting for all.");
+			wg.wait();
+		}
+		m_exporter->getPluginManager().logLockStats("sync_objects");
+
+		for (auto & ob : objects) {
+			PointerRNA vrayObject = RNA_pointer_get(&ob.ptr, "vray");
+			RNA_int_set(&vrayObject, "data_updated", CGR_NONE);
+			m_dependencyIndex.addObject(ob, is_object_exported(ob));
+		}
+		if (is_interrupted()) {
+			// some objects may not be exported, check all on next update
+			m_dependencyIndex.clear();
+		}
+	}
+	else if (!m_frameExporter.isCurrentSubframe()) {
 		CondWaitGroup wg(m_scene.objects.length() - m_frameExporter.countObjectsWithSubframes());
 		for (auto & ob : Blender::collection(m_scene.objects)) {
 			// If motion blur is enabled, export only object without subframes, theese with will be exported later
@@ -1273,12 +1529,20 @@ void SceneExporter::sync_objects(const bool check_updated) {
 			getLog().info("Started export for all objects - waiting for all.");
 			wg.wait();
 		}
+		m_exporter->getPluginManager().logLockStats("sync_objects");
+
+		// updates export only the objects depending on updated data, in viewport rendering
+		m_dependencyIndex.clear();
+		const bool buildIndex = is_viewport() && !is_interrupted();
 
 		// this needs to happen after all object are already exported
 		for (auto & ob : Blender::collection(m_scene.objects)) {
 			// Reset update flag
 			PointerRNA vrayObject = RNA_pointer_get(&ob.ptr, "vray");
 			RNA_int_set(&vrayObject, "data_updated", CGR_NONE);
+			if (buildIndex) {
+				m_dependencyIndex.addObject(ob, is_object_exported(ob));
+			}
 		}
 	}
 	else{
@@ -22,6 +22,7 @@
 #include "vfb_export_settings.h"
 #include "vfb_plugin_exporter.h"
 #include "vfb_node_exporter.h"
+#include "vfb_dependency_index.h"
 #include "vfb_utils_blender.h"
 #include "vfb_render_view.h"
 #include "vfb_rna.h"
@@ -167,6 +168,22 @@ public:
 		return m_mbGeomSamples;
 	}
 
+	/// Get the index of the motion blur sample being exported in range [0, getMotionBlurSamples())
+	/// -1 when not inside forEachExportFrame's motion blur loop (subframes, camera loop, after export)
+	int getMotionBlurSampleIndex() const {
+		return m_mbSampleIndex;
+	}
+
+	/// Get the distance in frames between two consecutive motion blur samples
+	float getMotionBlurSampleStep() const {
+		return m_mbSampleStep;
+	}
+
+	/// Get the offset in frames of the first motion blur sample from the render frame
+	float getMotionBlurIntervalStart() const {
+		return m_mbIntervalStartOffset;
+	}
+
 	/// Get the number of the first frame to render
 	/// It is either scene.frame_start or 1 if Camera Loop is enabled
 	int getFirstFrame() const;
@@ -286,6 +303,9 @@ private:
 	/// The distance between two motion blur keyframes (this is the analogue of the animation step in animation)
 	float m_mbSampleStep;
 
+	/// Index of the motion blur sample currently exported, -1 outside of the motion blur samples loop
+	int m_mbSampleIndex = -1;
+
 	/// Holds objects with subframes
 	/// Helps to export only objects with relevant subframe value to the current frame
 	SubframesHandler m_subframes;
@@ -355,6 +375,13 @@ public:
 	void                 pre_sync_object(const bool check_updated, BL::Object &ob, CondWaitGroup &wg);
 
 	void                 sync_objects(const bool check_updated=false);
+	/// Collect the objects to export in an update: the ones Blender tagged as updated and their dependents
+	/// @param updated - objects to export with update checks, tagged ones and their children / group instancers
+	/// @param forced - objects and materials to export fully, since data or node trees they use were updated
+	/// @return - false if objects were added, removed or renamed, or the index is not built, so all must be checked
+	bool                 collect_updated_objects(DependencyIndex::Dependents &updated, DependencyIndex::Dependents &forced);
+	/// Check if @ob is exported, as opposed to skipped or hidden
+	bool                 is_object_exported(BL::Object ob);
 	void                 sync_effects(const bool check_updated=false);
 	void                 sync_materials();
 
@@ -425,6 +452,7 @@ protected:
 	uint32_t             m_sceneComputedLayers; ///< Bool values for each layer compressed in one int
 
 	ThreadManager::Ptr   m_threadManager; ///< Pointer to the ThreadManager used for object export
+	DependencyIndex      m_dependencyIndex; ///< Objects and their dependencies as of the last viewport sync
 
 	bool                 m_isLocalView; ///< True if "local view" is enabled
 	bool                 m_isUndoSync; ///< True if the current sync is caused because user did undo action
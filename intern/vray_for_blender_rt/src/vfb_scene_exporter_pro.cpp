@@ -496,6 +496,9 @@ void ProductionExporter::cb_on_rt_image_updated()
 
 	m_imageDirty = true;
 
+	// only the regions updated since the last call are taken, so take them once for all results
+	HashMap<std::string, RenderImageTiles> passTiles;
+
 	for (auto & result : m_renderResultsList) {
 		BL::RenderResult::layers_iterator rrlIt;
 		result.layers.begin(rrlIt);
@@ -506,18 +509,19 @@ void ProductionExporter::cb_on_rt_image_updated()
 				for (renderLayer.passes.begin(rpIt); rpIt != renderLayer.passes.end(); ++rpIt) {
 					BL::RenderPass renderPass(*rpIt);
 					if (renderPass) {
-						RenderImage image = m_exporter->get_pass(renderPass.fullname());
-						RenderSizeParams imageSize = {image.w, image.h};
-
-						if (image && (imageSize == m_viewParams.renderSize || imageSize == m_viewParams.regionSize)) {
-							auto resx = result.resolution_x();
-							auto resy = result.resolution_y();
+						const std::string passName = renderPass.fullname();
+						auto tilesIter = passTiles.find(passName);
+						if (tilesIter == passTiles.end()) {
+							tilesIter = passTiles.emplace(passName, m_exporter->get_pass_tiles(passName)).first;
+						}
 
-							if (resx != image.w || resy != image.h) {
-								image.cropTo(resx, resy);
-							}
+						const RenderImageTiles & tiles = tilesIter->second;
+						RenderSizeParams imageSize = {tiles.w, tiles.h};
+						auto * bPass = reinterpret_cast<RenderPass*>(renderPass.ptr.data);
 
-							renderPass.rect(image.pixels);
+						if (tiles && bPass->channels == tiles.channels &&
+						    (imageSize == m_viewParams.renderSize || imageSize == m_viewParams.regionSize)) {
+							tiles.copyTo(bPass->rect, ImageSize{result.resolution_x(), result.resolution_y(), bPass->channels});
 						}
 					}
 				}
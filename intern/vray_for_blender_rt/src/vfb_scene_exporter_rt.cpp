@@ -170,6 +170,7 @@ void InteractiveExporter::draw()
 {
 	// TODO: is it worth it here to let python run for sync_view
 	// python_thread_state_save();
+	m_exporter->update_viewport_transport();
 	sync_view(true);
 	// python_thread_state_restore();
 
@@ -183,7 +184,7 @@ void InteractiveExporter::draw()
 		glPushMatrix();
 		// When initializing view params we multiply all sizes by this scale, but now we need to calculate blender sizes
 		// so we must go back in blender sizes
-		const float vpScale =  m_settings.getViewportResolutionPercentage();
+		const float vpScale = m_viewParams.viewport_scale;
 
 		int offsetY = 0, offsetX = 0;
 		if (m_viewParams.is_border) {
@@ -3,13 +3,30 @@
 #include "vfb_util_defines.h"
 #include "vfb_log.h"
 
+#include "BLI_threads.h"
+
+#include <algorithm>
+
 using namespace VRayForBlender;
 using namespace std;
 
+namespace {
+/// The manager owning the current thread, if it is a worker thread, used to push nested tasks to own queue
+thread_local const ThreadManager * tlsOwner = nullptr;
+/// The index of the worker in tlsOwner
+thread_local int tlsWorkerIndex = -1;
+}
+
 ThreadManager::ThreadManager(int thCount)
-	: m_stop(false)
+	: m_pending(0)
+	, m_nextQueue(0)
+	, m_taskOrder(0)
+	, m_stop(false)
 {
 	if (thCount > 0) {
+		for (int c = 0; c < thCount; ++c) {
+			m_queues.emplace_back(new WorkerQueue());
+		}
 		for (int c = 0; c < thCount; ++c) {
 			m_workers.emplace_back(thread(&ThreadManager::workerRun, this, c));
 		}
@@ -20,6 +37,14 @@ ThreadManager::Ptr ThreadManager::make(int thCount) {
 	return ThreadManager::Ptr(new ThreadManager(thCount));
 }
 
+int ThreadManager::threadCountFor(int requested) {
+	if (requested > 0) {
+		return std::min(requested, BLENDER_MAX_THREADS);
+	}
+	// respects blender's -t command line argument
+	return std::max(1, BLI_system_thread_count());
+}
+
 ThreadManager::~ThreadManager() {
 	// m_workers is not protected because there is no sane way to do this from inside the ThreadManager
 	// it can't handle calling some methond and dtor concurrently
@@ -30,10 +55,14 @@ ThreadManager::~ThreadManager() {
 }
 
 void ThreadManager::stop() {
-	m_stop = true;
+	{
+		// set under the lock so no worker can miss the notify between checking the flag and waiting
+		lock_guard<mutex> lock(m_sleepMtx);
+		m_stop = true;
+	}
 
 	if (!m_workers.empty()) {
-		m_queueCondVar.notify_all();
+		m_sleepCondVar.notify_all();
 
 		for (int c = 0; c < m_workers.size(); ++c) {
 			if (m_workers[c].joinable()) {
@@ -44,46 +73,111 @@ void ThreadManager::stop() {
 		}
 
 		m_workers.clear();
+
+		for (auto & queue : m_queues) {
+			lock_guard<mutex> lock(queue->mtx);
+			queue->tasks.clear();
+		}
+		{
+			lock_guard<mutex> lock(m_highMtx);
+			m_highTasks.clear();
+		}
+		m_pending = 0;
 	}
 }
 
-void ThreadManager::addTask(ThreadManager::Task task, ThreadManager::Priority priority) {
+void ThreadManager::addTask(ThreadManager::Task task, ThreadManager::Priority priority, ThreadManager::Cost cost) {
 	if (m_workers.empty()) {
 		// no workers - do the job ourselves
 		task(-1, m_stop);
+		return;
+	}
+
+	if (priority == Priority::HIGH) {
+		// as with a single queue, the last added HIGH task is started next by whichever worker is free
+		lock_guard<mutex> lock(m_highMtx);
+		m_highTasks.push_front(std::move(task));
 	} else {
-		{
-			lock_guard<mutex> lock(m_queueMtx);
-			if (priority == Priority::HIGH) {
-				m_tasks.push_front(task);
-			} else {
-				m_tasks.push_back(task);
-			}
+		QueuedTask item;
+		item.task = std::move(task);
+		item.cost = std::max<Cost>(cost, 0);
+		item.order = m_taskOrder++;
+
+		// workers adding tasks keep them in their own queue, others spread them evenly
+		const int queueIdx = tlsOwner == this ? tlsWorkerIndex : (m_nextQueue++ % m_queues.size());
+		WorkerQueue & queue = *m_queues[queueIdx];
+		lock_guard<mutex> lock(queue.mtx);
+		queue.tasks.push_back(std::move(item));
+		std::push_heap(queue.tasks.begin(), queue.tasks.end(), QueuedTaskLess());
+	}
+	{
+		lock_guard<mutex> lock(m_sleepMtx);
+		++m_pending;
+	}
+	m_sleepCondVar.notify_one();
+}
+
+bool ThreadManager::popTaskFrom(int queueIdx, Task & task) {
+	WorkerQueue & queue = *m_queues[queueIdx];
+	lock_guard<mutex> lock(queue.mtx);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+
+	std::pop_heap(queue.tasks.begin(), queue.tasks.end(), QueuedTaskLess());
+	task = std::move(queue.tasks.back().task);
+	queue.tasks.pop_back();
+	--m_pending;
+	return true;
+}
+
+bool ThreadManager::popHighTask(Task & task) {
+	lock_guard<mutex> lock(m_highMtx);
+	if (m_highTasks.empty()) {
+		return false;
+	}
+
+	task = std::move(m_highTasks.front());
+	m_highTasks.pop_front();
+	--m_pending;
+	return true;
+}
+
+bool ThreadManager::popTask(int thIdx, Task & task) {
+	if (popHighTask(task) || popTaskFrom(thIdx, task)) {
+		return true;
+	}
+
+	// own queue is empty - steal the most expensive task from the next non empty queue
+	const int queueCount = m_queues.size();
+	for (int c = 1; c < queueCount; ++c) {
+		if (popTaskFrom((thIdx + c) % queueCount, task)) {
+			return true;
 		}
-		m_queueCondVar.notify_one();
 	}
+	return false;
 }
 
 void ThreadManager::workerRun(int thIdx) {
 	getLog().info("Thread [%d] starting...", thIdx);
 
+	tlsOwner = this;
+	tlsWorkerIndex = thIdx;
+
 	while (!m_stop) {
 		Task task;
-		{
-			unique_lock<mutex> lock(m_queueMtx);
-			// wait for task or stop
-			m_queueCondVar.wait(lock, [this] { return !m_tasks.empty() || m_stop; });
-
-			if (m_stop) {
-				break;
-			}
-
-			task = m_tasks.front();
-			m_tasks.pop_front();
+		if (popTask(thIdx, task)) {
+			task(thIdx, m_stop);
+			continue;
 		}
 
-		task(thIdx, m_stop);
+		unique_lock<mutex> lock(m_sleepMtx);
+		// wait for task or stop
+		m_sleepCondVar.wait(lock, [this] { return m_pending > 0 || m_stop; });
 	}
 
+	tlsOwner = nullptr;
+	tlsWorkerIndex = -1;
+
 	getLog().info("Thread [%d] stopping...", thIdx);
 }
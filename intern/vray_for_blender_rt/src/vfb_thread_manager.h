@@ -30,6 +30,7 @@
 #include <vector>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 
 namespace VRayForBlender {
 
@@ -134,7 +135,8 @@ private:
 	WGType & m_waitGroup;
 };
 
-/// Basic thread manager able to execute tasks on different threads
+/// Thread manager able to execute tasks on different threads
+/// Each worker owns a queue ordered by task cost, idle workers steal from the queues of the others
 class ThreadManager {
 public:
 	typedef std::shared_ptr<ThreadManager> Ptr;
@@ -143,6 +145,9 @@ public:
 	// must obey stop flag asap, threadIndex == -1 means calling thread (thCount == 0)
 	typedef std::function<void(int threadIndex, const volatile bool & stop)> Task;
 
+	/// Relative cost estimate of a task, queued tasks with bigger cost are started first
+	typedef int64_t Cost;
+
 	enum class Priority {
 		LOW, HIGH,
 	};
@@ -151,6 +156,10 @@ public:
 	// thCount 0 will mean that addTask will block and complete the task on the current thread
 	static Ptr make(int thCount);
 
+	/// Get the number of worker threads to create
+	/// @requested - user requested thread count, 0 or less means one thread per logical core
+	static int threadCountFor(int requested);
+
 	ThreadManager(const ThreadManager &) = delete;
 	ThreadManager & operator=(const ThreadManager &) = delete;
 
@@ -168,11 +177,31 @@ public:
 	void stop();
 
 	// Add task to queue
-	// @task with LOW  @priority will be added at the end      of queue
-	// @task with HIGH @priority will be added at the begining of queue
+	// @task with LOW  @priority will be ordered by @cost, tasks with same cost are started in order of adding
+	// @task with HIGH @priority will be started before any LOW priority task, the last added HIGH task first
 	// okay to be called concurrently
-	void addTask(Task task, Priority priority);
+	void addTask(Task task, Priority priority, Cost cost = 0);
 private:
+	/// Task waiting in some worker's queue
+	struct QueuedTask {
+		Task     task;  ///< the task itself
+		Cost     cost;  ///< the cost used for ordering
+		uint64_t order; ///< sequence number, used to keep FIFO order for tasks with same cost
+	};
+
+	/// Orders QueuedTask so that std::*_heap functions keep the most expensive and oldest task on top
+	struct QueuedTaskLess {
+		bool operator()(const QueuedTask & left, const QueuedTask & right) const {
+			return left.cost < right.cost || (left.cost == right.cost && left.order > right.order);
+		}
+	};
+
+	/// Queue owned by a single worker, other workers can steal from it
+	struct WorkerQueue {
+		std::mutex              mtx;   ///< lock guarding @tasks
+		std::vector<QueuedTask> tasks; ///< max-heap of tasks ordered by QueuedTaskLess
+	};
+
 	/// Initialize ThreadManager
 	/// @thCount - number of threads to create, if 0 all tasks will be executed immediately on calling thread
 	ThreadManager(int thCount);
@@ -180,9 +209,31 @@ private:
 	/// Base function for each thread
 	void workerRun(int thIdx);
 
-	std::mutex               m_queueMtx;     ///< lock guarding @m_tasks
-	std::condition_variable  m_queueCondVar; ///< cond var for threads to wait for new tasks
-	std::deque<Task>         m_tasks;        ///< queue of the pending tasks
+	/// Get the next task for worker, first taking HIGH priority tasks, then looking in it's own queue and then stealing from the others
+	/// @thIdx - the index of the worker
+	/// @task [out] - the task to execute
+	/// @return - true if task was found
+	bool popTask(int thIdx, Task & task);
+
+	/// Try to take the top task from a queue
+	/// @queueIdx - index of the queue in @m_queues
+	/// @task [out] - the task to execute
+	/// @return - true if task was found
+	bool popTaskFrom(int queueIdx, Task & task);
+
+	/// Try to take the last added HIGH priority task
+	/// @task [out] - the task to execute
+	/// @return - true if task was found
+	bool popHighTask(Task & task);
+
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues; ///< one task queue per worker thread
+	std::mutex               m_highMtx;      ///< lock guarding @m_highTasks
+	std::deque<Task>         m_highTasks;    ///< HIGH priority tasks shared by all workers, newest first
+	std::atomic<int>         m_pending;      ///< number of tasks in all queues, used to put workers to sleep
+	std::atomic<unsigned>    m_nextQueue;    ///< round robin counter for tasks added from non worker threads
+	std::atomic<uint64_t>    m_taskOrder;    ///< sequence counter for QueuedTask::order
+	std::mutex               m_sleepMtx;     ///< lock for @m_sleepCondVar
+	std::condition_variable  m_sleepCondVar; ///< cond var for threads to wait for new tasks
 	std::vector<std::thread> m_workers;      ///< all worker threads created for this instace
 	volatile bool            m_stop;         ///< if set to true, will stop all threads, also passed to each task as second argument
 };
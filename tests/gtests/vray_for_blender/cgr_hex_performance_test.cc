@@ -0,0 +1,73 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_hex.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+}
+
+#include <string>
+#include <vector>
+
+/* Roughly the vertex array of a 5M vertex mesh. */
+#define TESTCASE_SIZE (5000000 * 3 * sizeof(float))
+
+#define TESTCASE_RUNS 10
+
+static std::vector<uint8_t> perf_data()
+{
+	std::vector<uint8_t> data(TESTCASE_SIZE);
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < data.size(); i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 24;
+	}
+	return data;
+}
+
+TEST(cgr_hex, HexEncode)
+{
+	const std::vector<uint8_t> data = perf_data();
+	std::string str(data.size() * 2, '\0');
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	TIMEIT_START_AVERAGED(hex_scalar);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		HexEncodeScalar(data.data(), data.size(), &str[0]);
+	}
+	TIMEIT_END_AVERAGED(hex_scalar);
+
+	TIMEIT_START_AVERAGED(hex_vectorized);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		HexEncode(data.data(), data.size(), &str[0]);
+	}
+	TIMEIT_END_AVERAGED(hex_vectorized);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(cgr_hex, Base41Encode)
+{
+	const std::vector<uint8_t> data = perf_data();
+	std::string str(data.size() / 2 * 3, '\0');
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	TIMEIT_START_AVERAGED(base41_scalar);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		Base41EncodeScalar(data.data(), data.size(), &str[0]);
+	}
+	TIMEIT_END_AVERAGED(base41_scalar);
+
+	TIMEIT_START_AVERAGED(base41_vectorized);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		Base41Encode(data.data(), data.size(), &str[0]);
+	}
+	TIMEIT_END_AVERAGED(base41_vectorized);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
@@ -0,0 +1,127 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_hex.h"
+
+#include <string>
+#include <vector>
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+static std::string hex_encode(const std::vector<uint8_t> &data, bool scalar)
+{
+	std::string str(data.size() * 2, '\0');
+	if (scalar) {
+		HexEncodeScalar(data.data(), data.size(), &str[0]);
+	}
+	else {
+		HexEncode(data.data(), data.size(), &str[0]);
+	}
+	return str;
+}
+
+static std::string base41_encode(const std::vector<uint8_t> &data, bool scalar)
+{
+	std::string str(data.size() / 2 * 3, '\0');
+	if (scalar) {
+		Base41EncodeScalar(data.data(), data.size(), &str[0]);
+	}
+	else {
+		Base41Encode(data.data(), data.size(), &str[0]);
+	}
+	return str;
+}
+
+static int base41_digit(char c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= '0' && c <= '9') return c - '0' + 26;
+	if (c >= 'a' && c <= 'e') return c - 'a' + 36;
+	return -1;
+}
+
+static std::vector<uint8_t> base41_decode(const std::string &str)
+{
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i + 3 <= str.size(); i += 3) {
+		const int w = base41_digit(str[i]) + base41_digit(str[i + 1]) * 41 + base41_digit(str[i + 2]) * 41 * 41;
+		data.push_back(w & 0xFF);
+		data.push_back(w >> 8);
+	}
+	return data;
+}
+
+static std::vector<uint8_t> hex_decode(const std::string &str)
+{
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i + 2 <= str.size(); i += 2) {
+		data.push_back(std::stoi(str.substr(i, 2), nullptr, 16));
+	}
+	return data;
+}
+
+static std::vector<uint8_t> pseudo_random_data(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 24;
+	}
+	return data;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(cgr_hex, HexKnownValues)
+{
+	const std::vector<uint8_t> data = {0x00, 0x01, 0x7F, 0x80, 0xAB, 0xCD, 0xEF, 0xFF, 0x10, 0x29};
+	EXPECT_EQ("00017F80ABCDEFFF1029", hex_encode(data, true));
+	EXPECT_EQ("00017F80ABCDEFFF1029", hex_encode(data, false));
+}
+
+TEST(cgr_hex, Base41KnownValues)
+{
+	const std::vector<uint16_t> words = {0, 40, 41, 1680, 1681, 65535};
+	std::vector<uint8_t> data;
+	for (uint16_t w : words) {
+		data.push_back(w & 0xFF);
+		data.push_back(w >> 8);
+	}
+	EXPECT_EQ("AAAeAAABAeeAAABRec", base41_encode(data, true));
+	EXPECT_EQ("AAAeAAABAeeAAABRec", base41_encode(data, false));
+}
+
+TEST(cgr_hex, Base41AllWords)
+{
+	std::vector<uint8_t> data;
+	for (int w = 0; w < 65536; w++) {
+		data.push_back(w & 0xFF);
+		data.push_back(w >> 8);
+	}
+	const std::string str = base41_encode(data, false);
+	EXPECT_EQ(base41_encode(data, true), str);
+	EXPECT_EQ(data, base41_decode(str));
+}
+
+TEST(cgr_hex, MatchesScalarAllSizes)
+{
+	/* Cover every tail length of the vectorized loops. */
+	for (size_t size = 0; size < 200; size++) {
+		const std::vector<uint8_t> data = pseudo_random_data(size);
+		EXPECT_EQ(hex_encode(data, true), hex_encode(data, false));
+
+		const std::vector<uint8_t> even(data.begin(), data.begin() + (size & ~size_t(1)));
+		EXPECT_EQ(base41_encode(even, true), base41_encode(even, false));
+	}
+}
+
+TEST(cgr_hex, RoundTrip)
+{
+	const std::vector<uint8_t> data = pseudo_random_data(1 << 16);
+	EXPECT_EQ(data, hex_decode(hex_encode(data, false)));
+	EXPECT_EQ(data, base41_decode(base41_encode(data, false)));
+}
@@ -0,0 +1,172 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_voxel.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+static const int brick_size = 8;
+
+static float voxel_at(const std::vector<float> &grid, const int res[3], int x, int y, int z)
+{
+	if (x < 0 || y < 0 || z < 0 || x >= res[0] || y >= res[1] || z >= res[2]) {
+		return 0.0f;
+	}
+	return grid[(size_t(z) * res[1] + y) * res[0] + x];
+}
+
+/* Trilinear sample of @grid at voxel coordinates, 0 outside the grid. */
+static float sample(const std::vector<float> &grid, const int res[3], float x, float y, float z)
+{
+	const int x0 = int(floorf(x)), y0 = int(floorf(y)), z0 = int(floorf(z));
+	const float fx = x - x0, fy = y - y0, fz = z - z0;
+
+	float result = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		const int dx = i & 1, dy = (i >> 1) & 1, dz = (i >> 2) & 1;
+		const float w = (dx ? fx : 1.0f - fx) * (dy ? fy : 1.0f - fy) * (dz ? fz : 1.0f - fz);
+		result += w * voxel_at(grid, res, x0 + dx, y0 + dy, z0 + dz);
+	}
+	return result;
+}
+
+/* Export @grid the sparse way and return the cropped grid. */
+static std::vector<float> sparse_export(const std::vector<float> &grid, const int res[3], float threshold,
+                                        bool quantize, VoxelRegion &region)
+{
+	const float *grids[] = {grid.data()};
+	std::vector<char> active;
+	region = FindActiveVoxelBricks(grids, 1, res, brick_size, threshold, active);
+
+	std::vector<float> cropped(size_t(region.size[0]) * region.size[1] * region.size[2], -1.0f);
+	CopyVoxelBricks(cropped.data(), grid.data(), res, region, brick_size, active, quantize);
+	return cropped;
+}
+
+/* A smoke puff: a gaussian blob around @center. */
+static std::vector<float> make_puff(const int res[3], const float center[3], float radius)
+{
+	std::vector<float> grid(size_t(res[0]) * res[1] * res[2]);
+	for (int z = 0; z < res[2]; z++) {
+		for (int y = 0; y < res[1]; y++) {
+			for (int x = 0; x < res[0]; x++) {
+				const float dx = x - center[0], dy = y - center[1], dz = z - center[2];
+				const float d2 = (dx * dx + dy * dy + dz * dz) / (radius * radius);
+				grid[(size_t(z) * res[1] + y) * res[0] + x] = d2 < 1.0f ? expf(-4.0f * d2) : 0.0f;
+			}
+		}
+	}
+	return grid;
+}
+
+/* Compare trilinear samples of the dense grid and of the sparse grid at the same places. */
+static float max_sample_error(const std::vector<float> &dense, const std::vector<float> &sparse,
+                              const int res[3], const VoxelRegion &region)
+{
+	float max_error = 0.0f;
+	for (float z = -1.0f; z < res[2] + 1.0f; z += 0.7f) {
+		for (float y = -1.0f; y < res[1] + 1.0f; y += 0.9f) {
+			for (float x = -1.0f; x < res[0] + 1.0f; x += 1.1f) {
+				const float expected = sample(dense, res, x, y, z);
+				const float actual = sample(sparse, region.size,
+				                            x - region.offset[0], y - region.offset[1], z - region.offset[2]);
+				max_error = std::max(max_error, fabsf(expected - actual));
+			}
+		}
+	}
+	return max_error;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(cgr_voxel, EmptyGrid)
+{
+	const int res[3] = {20, 17, 9};
+	std::vector<float> grid(res[0] * res[1] * res[2], 0.0f);
+
+	VoxelRegion region;
+	std::vector<float> cropped = sparse_export(grid, res, 0.0f, false, region);
+
+	for (int c = 0; c < 3; c++) {
+		EXPECT_EQ(0, region.offset[c]);
+		EXPECT_EQ(1, region.size[c]);
+	}
+	ASSERT_EQ(1u, cropped.size());
+	EXPECT_EQ(0.0f, cropped[0]);
+}
+
+TEST(cgr_voxel, SingleVoxel)
+{
+	const int res[3] = {40, 33, 25};
+	std::vector<float> grid(res[0] * res[1] * res[2], 0.0f);
+	grid[(size_t(20) * res[1] + 12) * res[0] + 30] = 0.5f;
+
+	VoxelRegion region;
+	std::vector<float> cropped = sparse_export(grid, res, 0.0f, false, region);
+
+	/* Brick (3, 1, 2) grown by one voxel, clamped to the grid. */
+	EXPECT_EQ(23, region.offset[0]);
+	EXPECT_EQ(10, region.size[0]);
+	EXPECT_EQ(7, region.offset[1]);
+	EXPECT_EQ(10, region.size[1]);
+	EXPECT_EQ(15, region.offset[2]);
+	EXPECT_EQ(25 - 15, region.size[2]);
+
+	EXPECT_EQ(0.0f, max_sample_error(grid, cropped, res, region));
+}
+
+TEST(cgr_voxel, MatchesDense)
+{
+	const int res[3] = {64, 50, 37};
+	const float center[3] = {40.0f, 20.0f, 18.0f};
+	const std::vector<float> grid = make_puff(res, center, 9.0f);
+
+	VoxelRegion region;
+	const std::vector<float> cropped = sparse_export(grid, res, 0.0f, false, region);
+
+	EXPECT_LT(cropped.size(), grid.size() / 4);
+	EXPECT_EQ(0.0f, max_sample_error(grid, cropped, res, region));
+}
+
+TEST(cgr_voxel, Threshold)
+{
+	const int res[3] = {64, 64, 64};
+	const float center[3] = {32.0f, 32.0f, 32.0f};
+	const float threshold = 0.01f;
+	const std::vector<float> grid = make_puff(res, center, 20.0f);
+
+	VoxelRegion region;
+	const std::vector<float> cropped = sparse_export(grid, res, threshold, false, region);
+
+	/* Only voxels of bricks with all values below the threshold are dropped. */
+	EXPECT_LE(max_sample_error(grid, cropped, res, region), threshold);
+}
+
+TEST(cgr_voxel, QuantizeHalf)
+{
+	const int res[3] = {32, 32, 32};
+	const float center[3] = {16.0f, 16.0f, 16.0f};
+	const std::vector<float> grid = make_puff(res, center, 12.0f);
+
+	VoxelRegion region;
+	const std::vector<float> cropped = sparse_export(grid, res, 0.0f, true, region);
+
+	/* Relative error of half precision is 2^-11, values are at most 1. */
+	EXPECT_LE(max_sample_error(grid, cropped, res, region), 1.0f / 2048.0f);
+
+	EXPECT_EQ(1.0f, QuantizeHalf(1.0f));
+	EXPECT_EQ(-2.5f, QuantizeHalf(-2.5f));
+	EXPECT_EQ(65504.0f, QuantizeHalf(1e6f));
+	EXPECT_EQ(0.0f, QuantizeHalf(1e-6f));
+	EXPECT_EQ(1.0f + 1.0f / 1024.0f, QuantizeHalf(1.0f + 1.0f / 1024.0f));
+	/* Ties round to even. */
+	EXPECT_EQ(1.0f, QuantizeHalf(1.0f + 1.0f / 2048.0f));
+	EXPECT_EQ(1.0f + 2.0f / 1024.0f, QuantizeHalf(1.0f + 3.0f / 2048.0f));
+}
@@ -0,0 +1,96 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_vrscene.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+/* Input and output block sizes of AppendStringZip. */
+static const size_t zip_in_block = 1 << 24;
+static const size_t zip_out_block = 1 << 16;
+
+/* Random bytes, deflate output is a little bigger than the input. */
+static std::vector<u_int8_t> random_data(size_t size)
+{
+	std::mt19937 rng(size);
+	std::vector<u_int8_t> data(size);
+	for (size_t i = 0; i < size; i++) {
+		data[i] = u_int8_t(rng());
+	}
+	return data;
+}
+
+/* Slowly changing values, compressed to a fraction of the input. */
+static std::vector<u_int8_t> compressible_data(size_t size)
+{
+	std::vector<u_int8_t> data(size);
+	for (size_t i = 0; i < size; i++) {
+		data[i] = u_int8_t((i / 64) * 7);
+	}
+	return data;
+}
+
+static void check_same_as_get(const std::vector<u_int8_t> &data)
+{
+	char *expected = GetStringZip(data.data(), data.size());
+	ASSERT_TRUE(expected != NULL);
+
+	std::string out;
+	EXPECT_TRUE(AppendStringZip(data.data(), data.size(), out));
+	EXPECT_EQ(std::string(expected), out);
+
+	delete [] expected;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(cgr_vrscene, AppendZipEmpty)
+{
+	check_same_as_get(std::vector<u_int8_t>());
+}
+
+TEST(cgr_vrscene, AppendZipSmall)
+{
+	for (size_t size = 1; size < 8; size++) {
+		check_same_as_get(random_data(size));
+		check_same_as_get(compressible_data(size));
+	}
+}
+
+TEST(cgr_vrscene, AppendZipKeepsPrefix)
+{
+	const std::vector<u_int8_t> data = random_data(1000);
+	char *expected = GetStringZip(data.data(), data.size());
+
+	std::string out = "ListInt(";
+	EXPECT_TRUE(AppendStringZip(data.data(), data.size(), out));
+	EXPECT_EQ("ListInt(" + std::string(expected), out);
+
+	delete [] expected;
+}
+
+TEST(cgr_vrscene, AppendZipOutputBlock)
+{
+	/* Compressed size crosses the output block, odd and even sizes leave a byte for the next block. */
+	for (size_t size = zip_out_block - 16; size < zip_out_block + 16; size++) {
+		check_same_as_get(random_data(size));
+	}
+	check_same_as_get(random_data(3 * zip_out_block + 1));
+}
+
+TEST(cgr_vrscene, AppendZipInputBlock)
+{
+	const size_t sizes[] = {zip_in_block - 1, zip_in_block, zip_in_block + 1, 2 * zip_in_block + 3};
+	for (size_t size : sizes) {
+		check_same_as_get(compressible_data(size));
+	}
+	/* Input block ends while the output block is partly filled. */
+	check_same_as_get(random_data(zip_in_block + 1));
+}
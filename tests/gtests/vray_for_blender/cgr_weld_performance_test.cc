@@ -0,0 +1,105 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_weld.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+}
+
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+/* UV corners of a 2.5M quad grid, 10M corners. */
+#define TESTCASE_SIDE 1581
+
+#define TESTCASE_RUNS 5
+
+static std::vector<float> perf_data()
+{
+	std::vector<float> values;
+	values.reserve(size_t(TESTCASE_SIDE) * TESTCASE_SIDE * 4 * 3);
+	for (int y = 0; y < TESTCASE_SIDE; y++) {
+		for (int x = 0; x < TESTCASE_SIDE; x++) {
+			const int corners[4][2] = {{x, y}, {x + 1, y}, {x + 1, y + 1}, {x, y + 1}};
+			for (int c = 0; c < 4; c++) {
+				values.push_back(corners[c][0] / float(TESTCASE_SIDE));
+				values.push_back(corners[c][1] / float(TESTCASE_SIDE));
+				values.push_back(0.0f);
+			}
+		}
+	}
+	return values;
+}
+
+/* The node based hash set welding the exporter used before. */
+struct Vertex {
+	float v[3];
+	mutable int index;
+
+	bool operator==(const Vertex &other) const
+	{
+		return v[0] == other.v[0] && v[1] == other.v[1] && v[2] == other.v[2];
+	}
+};
+
+struct VertexHash {
+	size_t operator()(const Vertex &vertex) const
+	{
+		/* FNV-1a over the bytes, a real hash so the set is not slowed down by collisions. */
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(vertex.v);
+		size_t hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(vertex.v); i++) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+		return hash;
+	}
+};
+
+static int weld_hash_set(const float (*values)[3], int count, int *indices)
+{
+	std::unordered_set<Vertex, VertexHash> set;
+	for (int i = 0; i < count; i++) {
+		Vertex vertex;
+		memcpy(vertex.v, values[i], sizeof(vertex.v));
+		set.insert(vertex);
+	}
+	int index = 0;
+	for (const Vertex &vertex : set) {
+		vertex.index = index++;
+	}
+	for (int i = 0; i < count; i++) {
+		Vertex vertex;
+		memcpy(vertex.v, values[i], sizeof(vertex.v));
+		indices[i] = set.find(vertex)->index;
+	}
+	return int(set.size());
+}
+
+TEST(cgr_weld, WeldVectors)
+{
+	const std::vector<float> data = perf_data();
+	const int count = int(data.size() / 3);
+	const float (*values)[3] = reinterpret_cast<const float(*)[3]>(data.data());
+	std::vector<int> indices(count);
+	std::vector<int> sources(count);
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	TIMEIT_START_AVERAGED(weld_hash_set);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		weld_hash_set(values, count, indices.data());
+	}
+	TIMEIT_END_AVERAGED(weld_hash_set);
+
+	TIMEIT_START_AVERAGED(weld_flat);
+	for (int i = 0; i < TESTCASE_RUNS; i++) {
+		WeldVectors(values, count, indices.data(), sources.data());
+	}
+	TIMEIT_END_AVERAGED(weld_flat);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
@@ -0,0 +1,113 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "utils/cgr_weld.h"
+
+#include <vector>
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+typedef std::vector<std::vector<float>> Vectors;
+
+/* Weld @values and check the result maps each value to an equal unique vector. */
+static int weld_and_check(const std::vector<float> &values)
+{
+	const int count = int(values.size() / 3);
+	const float (*vectors)[3] = reinterpret_cast<const float(*)[3]>(values.data());
+
+	std::vector<int> indices(count, -1);
+	std::vector<int> sources(count, -1);
+	const int unique = WeldVectors(vectors, count, indices.data(), sources.data());
+
+	for (int i = 0; i < count; i++) {
+		EXPECT_GE(indices[i], 0);
+		EXPECT_LT(indices[i], unique);
+		const float *u = vectors[sources[indices[i]]];
+		EXPECT_EQ(vectors[i][0], u[0]);
+		EXPECT_EQ(vectors[i][1], u[1]);
+		EXPECT_EQ(vectors[i][2], u[2]);
+	}
+
+	/* Unique vectors are in order of first occurrence and are all different. */
+	for (int i = 0; i < unique; i++) {
+		EXPECT_EQ(indices[sources[i]], i);
+		if (i > 0) {
+			EXPECT_LT(sources[i - 1], sources[i]);
+		}
+	}
+
+	return unique;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(cgr_weld, Empty)
+{
+	EXPECT_EQ(0, WeldVectors(NULL, 0, NULL, NULL));
+}
+
+TEST(cgr_weld, Simple)
+{
+	const std::vector<float> values = {
+	    0.0f, 0.0f, 0.0f,
+	    1.0f, 0.0f, 0.0f,
+	    0.0f, 0.0f, 0.0f,
+	    1.0f, 1.0f, 0.0f,
+	    1.0f, 0.0f, 0.0f,
+	};
+
+	const float (*vectors)[3] = reinterpret_cast<const float(*)[3]>(values.data());
+	int indices[5];
+	int sources[5];
+	EXPECT_EQ(3, WeldVectors(vectors, 5, indices, sources));
+
+	const int expected_indices[] = {0, 1, 0, 2, 1};
+	const int expected_sources[] = {0, 1, 3};
+	for (int i = 0; i < 5; i++) {
+		EXPECT_EQ(expected_indices[i], indices[i]);
+	}
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ(expected_sources[i], sources[i]);
+	}
+}
+
+TEST(cgr_weld, NegativeZero)
+{
+	const std::vector<float> values = {
+	    0.0f, 0.5f, 0.0f,
+	    -0.0f, 0.5f, -0.0f,
+	};
+	EXPECT_EQ(1, weld_and_check(values));
+}
+
+TEST(cgr_weld, Grid)
+{
+	/* UVs of a grid, each inner vertex shared by 4 quads. */
+	const int side = 100;
+	std::vector<float> values;
+	for (int y = 0; y < side; y++) {
+		for (int x = 0; x < side; x++) {
+			const int corners[4][2] = {{x, y}, {x + 1, y}, {x + 1, y + 1}, {x, y + 1}};
+			for (int c = 0; c < 4; c++) {
+				values.push_back(corners[c][0] / float(side));
+				values.push_back(corners[c][1] / float(side));
+				values.push_back(0.0f);
+			}
+		}
+	}
+	EXPECT_EQ((side + 1) * (side + 1), weld_and_check(values));
+}
+
+TEST(cgr_weld, AllDifferent)
+{
+	std::vector<float> values;
+	for (int i = 0; i < 10000; i++) {
+		values.push_back(float(i));
+		values.push_back(float(i) * 0.5f);
+		values.push_back(1.0f / float(i + 1));
+	}
+	EXPECT_EQ(10000, weld_and_check(values));
+}
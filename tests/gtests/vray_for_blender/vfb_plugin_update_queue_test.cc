@@ -0,0 +1,127 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vfb_plugin_update_queue.h"
+
+#include <string>
+#include <vector>
+
+using namespace VRayForBlender;
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+/* Plugin, attribute and int value of a sent update. */
+struct SentUpdate {
+	std::string plugin;
+	std::string attr;
+	int value;
+
+	bool operator==(const SentUpdate &other) const {
+		return plugin == other.plugin && attr == other.attr && value == other.value;
+	}
+};
+
+static std::ostream &operator<<(std::ostream &os, const SentUpdate &update)
+{
+	return os << update.plugin << "::" << update.attr << "=" << update.value;
+}
+
+typedef std::vector<SentUpdate> SentUpdates;
+
+/* Stand-in for the ZMQ sender, records the updates of int properties. */
+static SentUpdates flush_queue(PluginUpdateQueue &queue)
+{
+	SentUpdates sent;
+	const int count = queue.flush([&sent](const std::string &plugin, const std::string &attr, const AttrValue &value) {
+		sent.push_back({plugin, attr, value.type == ValueTypeInt ? value.as<AttrSimpleType<int>>().value : -1});
+	});
+	EXPECT_EQ(int(sent.size()), count);
+	EXPECT_TRUE(queue.empty());
+	return sent;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(vfb_plugin_update_queue, Empty)
+{
+	PluginUpdateQueue queue;
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(SentUpdates(), flush_queue(queue));
+	EXPECT_EQ(0u, queue.getStats().flushes);
+}
+
+TEST(vfb_plugin_update_queue, CoalesceInFirstSetOrder)
+{
+	PluginUpdateQueue queue;
+	queue.push("node", "transform", AttrValue(1));
+	queue.push("mtl", "diffuse", AttrValue(2));
+	queue.push("node", "visible", AttrValue(3));
+	queue.push("node", "transform", AttrValue(4));
+	queue.push("mtl", "diffuse", AttrValue(5));
+	EXPECT_FALSE(queue.empty());
+
+	const SentUpdates expected = {
+	    {"node", "transform", 4},
+	    {"mtl", "diffuse", 5},
+	    {"node", "visible", 3},
+	};
+	EXPECT_EQ(expected, flush_queue(queue));
+
+	/* The next flush starts a new order. */
+	queue.push("node", "visible", AttrValue(6));
+	queue.push("node", "transform", AttrValue(7));
+	const SentUpdates expected_next = {
+	    {"node", "visible", 6},
+	    {"node", "transform", 7},
+	};
+	EXPECT_EQ(expected_next, flush_queue(queue));
+}
+
+TEST(vfb_plugin_update_queue, DropPlugin)
+{
+	PluginUpdateQueue queue;
+	queue.push("node", "transform", AttrValue(1));
+	queue.push("mtl", "diffuse", AttrValue(2));
+	queue.push("node", "visible", AttrValue(3));
+	queue.dropPlugin("node");
+	queue.dropPlugin("missing");
+
+	/* Pushed again after the drop, sent in the new order. */
+	queue.push("node", "visible", AttrValue(4));
+
+	const SentUpdates expected = {
+	    {"mtl", "diffuse", 2},
+	    {"node", "visible", 4},
+	};
+	EXPECT_EQ(expected, flush_queue(queue));
+}
+
+TEST(vfb_plugin_update_queue, Stats)
+{
+	PluginUpdateQueue queue;
+	queue.push("node", "transform", AttrValue(1));
+	queue.push("node", "transform", AttrValue(2));
+	queue.push("mtl", "diffuse", AttrValue(3));
+	queue.push("geom", "faces", AttrValue(AttrListInt({0, 1, 2, 3})));
+	queue.dropPlugin("mtl");
+	flush_queue(queue);
+	flush_queue(queue);
+
+	PluginUpdateQueue::Stats stats = queue.getStats();
+	EXPECT_EQ(4u, stats.queued);
+	EXPECT_EQ(1u, stats.coalesced);
+	EXPECT_EQ(1u, stats.dropped);
+	EXPECT_EQ(2u, stats.sent);
+	EXPECT_EQ(1u, stats.flushes);
+	/* Names of the sent updates and the list data. */
+	EXPECT_EQ(std::string("nodetransformgeomfaces").size() + 4 * sizeof(int), stats.bytes);
+
+	queue.resetStats();
+	stats = queue.getStats();
+	EXPECT_EQ(0u, stats.queued);
+	EXPECT_EQ(0u, stats.sent);
+	EXPECT_EQ(0u, stats.bytes);
+}
@@ -0,0 +1,115 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vfb_viewport_transport.h"
+
+using namespace VRayForBlender;
+
+/* -------------------------------------------------------------------- */
+/* helpers */
+
+typedef ViewportTransport::Format Format;
+typedef ViewportTransport::ImageType ImageType;
+
+static const Format preferred(ImageType::RGBA_REAL, 100, 1.f);
+
+/* Target latency of 100ms. */
+static const float target_seconds = 0.1f;
+
+static ViewportTransport::Clock::time_point at_ms(int ms)
+{
+	static const ViewportTransport::Clock::time_point start = ViewportTransport::Clock::now();
+	return start + std::chrono::milliseconds(ms);
+}
+
+/* Change the view every 100ms from @start_ms, answered after @latency_ms, until the format has a lower resolution.
+ * Returns the time of the last change. */
+static int move_until_scaled(ViewportTransport &transport, int start_ms, int latency_ms)
+{
+	int ms = start_ms;
+	for (int i = 0; i < 100 && transport.getFormat(at_ms(ms)).scale == 1.f; i++) {
+		ms += 100;
+		transport.viewChanged(at_ms(ms));
+		transport.imageReceived(at_ms(ms + latency_ms));
+	}
+	return ms;
+}
+
+/* -------------------------------------------------------------------- */
+/* tests */
+
+TEST(vfb_viewport_transport, Disabled)
+{
+	ViewportTransport transport;
+	transport.setPreferred(preferred, 0.f);
+	for (int ms = 0; ms < 5000; ms += 100) {
+		transport.viewChanged(at_ms(ms));
+		transport.imageReceived(at_ms(ms + 1000));
+	}
+	EXPECT_EQ(preferred, transport.getFormat(at_ms(5000)));
+}
+
+TEST(vfb_viewport_transport, FastViewKeepsPreferred)
+{
+	ViewportTransport transport;
+	transport.setPreferred(preferred, target_seconds);
+	for (int ms = 0; ms < 5000; ms += 100) {
+		transport.viewChanged(at_ms(ms));
+		transport.imageReceived(at_ms(ms + 20));
+	}
+	EXPECT_EQ(preferred, transport.getFormat(at_ms(5000)));
+}
+
+TEST(vfb_viewport_transport, SlowViewDegrades)
+{
+	ViewportTransport transport;
+	transport.setPreferred(preferred, target_seconds);
+
+	const int last_change = move_until_scaled(transport, 0, 300);
+	const Format format = transport.getFormat(at_ms(last_change));
+	EXPECT_EQ(ImageType::JPG, format.type);
+	EXPECT_LT(format.quality, 100);
+	EXPECT_LT(format.scale, 1.f);
+
+	/* Still cheap while the view keeps changing. */
+	EXPECT_EQ(format, transport.getFormat(at_ms(last_change + 500)));
+}
+
+TEST(vfb_viewport_transport, IdleRestoresPreferred)
+{
+	ViewportTransport transport;
+	transport.setPreferred(preferred, target_seconds);
+
+	const int last_change = move_until_scaled(transport, 0, 300);
+	ASSERT_LT(transport.getFormat(at_ms(last_change)).scale, 1.f);
+
+	/* Idle, the preferred format is restored and stays, there are no view changes from the resize. */
+	for (int ms = last_change + 1000; ms < last_change + 5000; ms += 100) {
+		EXPECT_EQ(preferred, transport.getFormat(at_ms(ms)));
+	}
+
+	/* The next change starts again from the preferred format, a single slow image does not degrade it. */
+	const int next_change = last_change + 5000;
+	transport.viewChanged(at_ms(next_change));
+	EXPECT_EQ(preferred, transport.getFormat(at_ms(next_change)));
+	transport.imageReceived(at_ms(next_change + 300));
+	EXPECT_EQ(preferred, transport.getFormat(at_ms(next_change + 300)));
+
+	/* And degrades again if the view keeps being slow. */
+	const int moved = move_until_scaled(transport, next_change, 300);
+	EXPECT_LT(transport.getFormat(at_ms(moved)).scale, 1.f);
+}
+
+TEST(vfb_viewport_transport, NewPreferredResets)
+{
+	ViewportTransport transport;
+	transport.setPreferred(preferred, target_seconds);
+
+	const int last_change = move_until_scaled(transport, 0, 300);
+	ASSERT_LT(transport.getFormat(at_ms(last_change)).scale, 1.f);
+
+	const Format jpeg(ImageType::JPG, 80, 1.f);
+	transport.setPreferred(jpeg, target_seconds);
+	EXPECT_EQ(jpeg, transport.getFormat(at_ms(last_change)));
+}
@@ -0,0 +1,282 @@
+# Apache License, Version 2.0
+
+# Headless export benchmark for the V-Ray For Blender RT exporter.
+#
+# Generates a synthetic scene (meshes, hair systems, dupli groups, material node trees),
+# exports it with the file exporter in "export only" mode and reports export time,
+# throughput, peak memory and, per plugin type, the export time, lock wait and input list
+# data size (from the export profiler).
+#
+# ./blender.bin --background --factory-startup --python tests/python/vray_export_benchmark.py -- \
+#     --outdir /tmp/vray_bench --objects 200 --verts 10000
+#
+# Pass --baseline with a report of a previous run to fail on export time regressions.
+
+import json
+import os
+import resource
+import sys
+import tempfile
+import time
+
+import bpy
+
+
+def enum_identifier(data, prop_name, value):
+    """ Get the identifier of enum property item by the value used by the exporter. """
+    for item in data.bl_rna.properties[prop_name].enum_items:
+        if item.value == value:
+            return item.identifier
+    raise ValueError("No item with value %d in %s.%s" % (value, data.bl_rna.identifier, prop_name))
+
+
+def clear_scene(scene):
+    for ob in list(scene.objects):
+        scene.objects.unlink(ob)
+    for ob in list(bpy.data.objects):
+        bpy.data.objects.remove(ob, do_unlink=True)
+
+
+def make_grid_mesh(name, verts):
+    """ Make a grid mesh with about @verts vertices. """
+    side = max(2, int(verts ** 0.5))
+    me = bpy.data.meshes.new(name)
+
+    coords = []
+    for y in range(side):
+        for x in range(side):
+            coords.append((x / side, y / side, 0.0))
+
+    faces = []
+    for y in range(side - 1):
+        for x in range(side - 1):
+            i = y * side + x
+            faces.append((i, i + 1, i + side + 1, i + side))
+
+    me.from_pydata(coords, [], faces)
+    me.uv_textures.new("UVMap")
+    me.update()
+    return me
+
+
+def make_material(name, use_nodes):
+    ma = bpy.data.materials.new(name)
+    if not use_nodes:
+        return ma
+
+    ntree = bpy.data.node_groups.new(name, 'VRayNodeTreeMaterial')
+    output = ntree.nodes.new('VRayNodeOutputMaterial')
+    mtl = ntree.nodes.new('VRayNodeMtlSingleBRDF')
+    brdf = ntree.nodes.new('VRayNodeBRDFVRayMtl')
+    ntree.links.new(brdf.outputs[0], mtl.inputs['BRDF'])
+    ntree.links.new(mtl.outputs[0], output.inputs['Material'])
+    ma.vray.ntree = ntree
+    return ma
+
+
+def build_scene(scene, args):
+    clear_scene(scene)
+
+    cam = bpy.data.objects.new("Camera", bpy.data.cameras.new("Camera"))
+    cam.location = (0.0, -20.0, 10.0)
+    scene.objects.link(cam)
+    scene.camera = cam
+
+    materials = [make_material("Material_%d" % i, args.node_trees) for i in range(max(1, args.materials))]
+
+    shared_mesh = make_grid_mesh("SharedMesh", args.verts) if args.shared_meshes else None
+    for i in range(args.objects):
+        me = shared_mesh or make_grid_mesh("Mesh_%d" % i, args.verts)
+        ob = bpy.data.objects.new("Object_%d" % i, me)
+        ob.location = (i % 32, i // 32, 0.0)
+        ob.active_material = materials[i % len(materials)]
+        scene.objects.link(ob)
+
+    for i in range(args.hair_systems):
+        ob = bpy.data.objects.new("Hair_%d" % i, make_grid_mesh("HairEmitter_%d" % i, 64))
+        ob.location = (i % 32, -4.0 - i // 32, 0.0)
+        scene.objects.link(ob)
+        ob.modifiers.new("Hair", 'PARTICLE_SYSTEM')
+        settings = ob.particle_systems[0].settings
+        settings.type = 'HAIR'
+        settings.count = args.hair_count
+        settings.hair_step = args.hair_steps
+
+    if args.dupli_instances:
+        group = bpy.data.groups.new("DupliGroup")
+        for i in range(args.dupli_group_size):
+            ob = bpy.data.objects.new("GroupObject_%d" % i, make_grid_mesh("GroupMesh_%d" % i, 256))
+            ob.location = (i * 0.5, 0.0, 0.0)
+            group.objects.link(ob)
+
+        for i in range(args.dupli_instances):
+            empty = bpy.data.objects.new("Dupli_%d" % i, None)
+            empty.dupli_type = 'GROUP'
+            empty.dupli_group = group
+            empty.location = (i % 32, 10.0 + i // 32, 0.0)
+            scene.objects.link(empty)
+
+    scene.update()
+
+
+def setup_exporter(scene, args, outdir):
+    scene.render.engine = 'VRAY_RENDER_RT'
+
+    exporter = scene.vray.Exporter
+    # values match the enums in vfb_export_settings.h and vfb_plugin_exporter_types.h
+    exporter.backend = enum_identifier(exporter, "backend", 0)          # ExpoterTypeFile
+    exporter.work_mode = enum_identifier(exporter, "work_mode", 2)      # WorkModeExportOnly
+    exporter.output = enum_identifier(exporter, "output", 0)            # OutputDirTypeUser
+    exporter.data_format = enum_identifier(exporter, "data_format", args.data_format)
+    exporter.output_dir = outdir
+    exporter.output_unique = False
+    exporter.auto_meshes = True
+    exporter.use_hair = True
+    exporter.export_threads = args.threads
+    exporter.export_profiler = True
+    exporter.export_profiler_path = os.path.join(outdir, "export_profile.json")
+
+    return exporter.export_profiler_path
+
+
+def directory_size(path):
+    size = 0
+    for root, _, files in os.walk(path):
+        for f in files:
+            if f.endswith(('.vrscene', '.vrbin')):
+                size += os.path.getsize(os.path.join(root, f))
+    return size
+
+
+def run_benchmark(args):
+    outdir = args.outdir or tempfile.mkdtemp(prefix="vray_export_benchmark_")
+    os.makedirs(outdir, exist_ok=True)
+
+    scene = bpy.context.scene
+    build_scene(scene, args)
+    profile_path = setup_exporter(scene, args, outdir)
+
+    times = []
+    for _ in range(args.repeat):
+        start = time.perf_counter()
+        bpy.ops.render.render()
+        times.append(time.perf_counter() - start)
+
+    seconds = min(times)
+    exported_bytes = directory_size(outdir)
+
+    plugins = {}
+    if os.path.exists(profile_path):
+        with open(profile_path) as f:
+            profile = json.load(f)
+        for item in profile.get("plugins", []):
+            calls = max(1, item["calls"] - item["cache_hits"])
+            plugins[item["name"]] = {
+                "calls": item["calls"],
+                "seconds": item["seconds"],
+                "wait_seconds": item["wait_seconds"],
+                "input_bytes": item["input_bytes"],
+                "input_bytes_per_plugin": item["input_bytes"] // calls,
+            }
+
+    # ru_maxrss is in kilobytes on Linux and bytes on macOS
+    peak_rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    if sys.platform != 'darwin':
+        peak_rss *= 1024
+
+    return {
+        "scene": {
+            "objects": args.objects,
+            "verts": args.verts,
+            "hair_systems": args.hair_systems,
+            "dupli_instances": args.dupli_instances,
+            "node_trees": args.node_trees,
+        },
+        "seconds": seconds,
+        "seconds_all": times,
+        "objects_per_second": (args.objects + args.hair_systems + args.dupli_instances) / seconds if seconds else 0.0,
+        "exported_bytes": exported_bytes,
+        "megabytes_per_second": exported_bytes / (1024.0 * 1024.0) / seconds if seconds else 0.0,
+        "peak_memory_bytes": peak_rss,
+        "plugins": plugins,
+    }
+
+
+def check_regression(report, baseline_path, tolerance):
+    with open(baseline_path) as f:
+        baseline = json.load(f)
+
+    ok = True
+    limit = baseline["seconds"] * (1.0 + tolerance)
+    if report["seconds"] > limit:
+        print("REGRESSION: export took %.3fs, baseline %.3fs (limit %.3fs)" %
+              (report["seconds"], baseline["seconds"], limit))
+        ok = False
+
+    limit = baseline["peak_memory_bytes"] * (1.0 + tolerance)
+    if report["peak_memory_bytes"] > limit:
+        print("REGRESSION: peak memory %d MB, baseline %d MB" %
+              (report["peak_memory_bytes"] >> 20, baseline["peak_memory_bytes"] >> 20))
+        ok = False
+
+    return ok
+
+
+def main():
+    import argparse
+
+    if '--' in sys.argv:
+        argv = sys.argv[sys.argv.index('--') + 1:]
+    else:
+        argv = []
+
+    parser = argparse.ArgumentParser(description="V-Ray For Blender export benchmark")
+    parser.add_argument("--addon", default="vb30", help="Module name of the V-Ray For Blender add-on")
+    parser.add_argument("--outdir", default="", help="Export directory, temporary if empty")
+    parser.add_argument("--report", default="", help="Write the benchmark report to this JSON file")
+    parser.add_argument("--baseline", default="", help="Report of a previous run to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.2, help="Allowed slowdown against the baseline")
+    parser.add_argument("--repeat", type=int, default=3, help="Number of exports, the fastest is reported")
+    parser.add_argument("--threads", type=int, default=0, help="Export threads, 0 for one per core")
+    parser.add_argument("--data-format", type=int, default=0, help="Value of the ExportFormat enum")
+    parser.add_argument("--objects", type=int, default=100)
+    parser.add_argument("--verts", type=int, default=10000, help="Vertices per mesh")
+    parser.add_argument("--shared-meshes", action='store_true', help="All objects use the same mesh")
+    parser.add_argument("--materials", type=int, default=8)
+    parser.add_argument("--node-trees", type=int, default=1, help="Use V-Ray node trees for materials")
+    parser.add_argument("--hair-systems", type=int, default=4)
+    parser.add_argument("--hair-count", type=int, default=10000)
+    parser.add_argument("--hair-steps", type=int, default=5)
+    parser.add_argument("--dupli-instances", type=int, default=100)
+    parser.add_argument("--dupli-group-size", type=int, default=4)
+    args = parser.parse_args(argv)
+
+    import addon_utils
+    if not addon_utils.enable(args.addon, default_set=True):
+        print("Failed to enable add-on \"%s\"" % args.addon)
+        sys.exit(1)
+
+    report = run_benchmark(args)
+
+    print("Export: %.3fs, %.1f objects/s, %.2f MB/s, peak memory %d MB" % (
+          report["seconds"], report["objects_per_second"],
+          report["megabytes_per_second"], report["peak_memory_bytes"] >> 20))
+    for name, item in sorted(report["plugins"].items(), key=lambda it: -it[1]["seconds"]):
+        print("  %-32s %8d calls %10.3fs %8.3fs wait %12d input bytes/plugin" % (
+              name, item["calls"], item["seconds"], item["wait_seconds"], item["input_bytes_per_plugin"]))
+
+    if args.report:
+        with open(args.report, 'w') as f:
+            json.dump(report, f, indent=2)
+
+    if args.baseline and not check_regression(report, args.baseline, args.tolerance):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except:
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)